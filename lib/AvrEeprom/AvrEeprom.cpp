@@ -0,0 +1,53 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "AvrEeprom.h"
+
+
+/**
+ * @file AvrEeprom.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+/**
+ * @brief Reads one byte
+ * @param address the address to read (0-E2END)
+ */
+uint8_t AvrEeprom::read(uint16_t address) {
+	return eeprom_read_byte((const uint8_t *) (uintptr_t) address);
+}
+
+/**
+ * @brief Writes one byte, the cell is left untouched if it already holds the value
+ * @param address the address to write (0-E2END)
+ * @param value the value to write
+ */
+void AvrEeprom::write(uint16_t address, uint8_t value) {
+	eeprom_update_byte((uint8_t *) (uintptr_t) address, value);
+}
+
+/**
+ * @brief Returns the size of the EEPROM in bytes
+ */
+uint16_t AvrEeprom::length(void) {
+	return E2END + 1;
+}
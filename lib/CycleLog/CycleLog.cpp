@@ -0,0 +1,216 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <Arduino.h>
+#include "CycleLog.h"
+
+
+/**
+ * @file CycleLog.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+/**
+ * @brief Instantiates a new log, restore() must be called before use
+ * @param eeprom the memory holding the log
+ * @param start the address of the first byte of the log
+ * @param length the number of bytes used by the log, rounded down to a whole number of slots
+ *
+ * The length is clamped to the end of the EEPROM. A length shorter than SLOT_SIZE
+ * gives a log without slots, which never restores nor commits.
+ */
+CycleLog::CycleLog(IEeprom &eeprom, uint16_t start, uint16_t length) : _eeprom(eeprom) {
+	_start = start;
+
+	uint16_t available = start < _eeprom.length() ? _eeprom.length() - start : 0;
+	if (length > available) {
+		length = available;
+	}
+
+	// Sequence numbers are compared with serial number arithmetic, less than 2^15 slots keeps it unambiguous
+	_slots = length / SLOT_SIZE > 0x7FFF ? 0x7FFF : length / SLOT_SIZE;
+
+	_empty = true;
+	_last = _slots > 0 ? _slots - 1 : 0;
+	_record.sequence = 0xFFFF;
+	_record.cycle = 0;
+	_record.result = 0;
+}
+
+/**
+ * @brief Scans the log for the most recent valid commit
+ * @return false if no valid commit was found, i.e. blank or erased EEPROM
+ */
+bool CycleLog::restore(void) {
+	_empty = true;
+	_last = _slots > 0 ? _slots - 1 : 0;
+	_record.sequence = 0xFFFF;
+	_record.cycle = 0;
+	_record.result = 0;
+
+	if (_slots == 0) {
+		return false;
+	}
+
+	CycleRecord record;
+
+	for (uint16_t slot = 0; slot < _slots; ++slot) {
+		if (!readSlot(slot, record)) {
+			continue;
+		}
+
+		if (_empty || (int16_t) (record.sequence - _record.sequence) > 0) {
+			_empty = false;
+			_last = slot;
+			_record = record;
+		}
+	}
+
+	return !_empty;
+}
+
+/**
+ * @brief Writes a new commit in the slot following the most recent one
+ * @param cycle the cycle to store (0-MAX_CYCLE)
+ * @param result the result of the cycle
+ */
+void CycleLog::commit(uint32_t cycle, uint8_t result) {
+	if (_slots == 0) {
+		return;
+	}
+
+	uint16_t slot = (_last + 1) % _slots;
+	uint16_t sequence = _record.sequence + 1;
+
+	uint8_t data[SLOT_SIZE];
+	data[0] = sequence & 0xFF;
+	data[1] = sequence >> 8;
+	data[2] = cycle & 0xFF;
+	data[3] = (cycle >> 8) & 0xFF;
+	data[4] = (cycle >> 16) & 0xFF;
+	data[5] = result;
+
+	uint16_t checksum = crc(data, 6);
+	data[6] = checksum & 0xFF;
+	data[7] = checksum >> 8;
+
+	for (uint8_t i = 0; i < SLOT_SIZE; ++i) {
+		_eeprom.write(address(slot) + i, data[i]);
+	}
+
+	_empty = false;
+	_last = slot;
+	_record.sequence = sequence;
+	_record.cycle = cycle & MAX_CYCLE;
+	_record.result = result;
+}
+
+/**
+ * @brief Returns true if nothing has been committed yet
+ */
+bool CycleLog::isEmpty(void) const {
+	return _empty;
+}
+
+/**
+ * @brief Returns the cycle of the most recent commit, 0 if empty
+ */
+uint32_t CycleLog::cycle(void) const {
+	return _record.cycle;
+}
+
+/**
+ * @brief Returns the result of the most recent commit, 0 if empty
+ */
+uint8_t CycleLog::result(void) const {
+	return _record.result;
+}
+
+/**
+ * @brief Reads a past commit
+ * @param age 0 for the most recent commit, 1 for the one before, up to capacity() - 1
+ * @param record filled with the commit
+ * @return false if there is no valid commit of that age
+ */
+bool CycleLog::read(uint16_t age, CycleRecord &record) {
+	if (_empty || age >= _slots) {
+		return false;
+	}
+
+	uint16_t slot = (_last + _slots - age) % _slots;
+
+	return readSlot(slot, record) && record.sequence == (uint16_t) (_record.sequence - age);
+}
+
+/**
+ * @brief Returns the number of commits kept in the log
+ */
+uint16_t CycleLog::capacity(void) const {
+	return _slots;
+}
+
+/**
+ * @brief Reads and checks one slot
+ * @param slot the slot to read
+ * @param record filled with the slot content
+ * @return false if the CRC does not match
+ */
+bool CycleLog::readSlot(uint16_t slot, CycleRecord &record) {
+	uint8_t data[SLOT_SIZE];
+
+	for (uint8_t i = 0; i < SLOT_SIZE; ++i) {
+		data[i] = _eeprom.read(address(slot) + i);
+	}
+
+	if (crc(data, 6) != (data[6] | (uint16_t) data[7] << 8)) {
+		return false;
+	}
+
+	record.sequence = data[0] | (uint16_t) data[1] << 8;
+	record.cycle = data[2] | (uint32_t) data[3] << 8 | (uint32_t) data[4] << 16;
+	record.result = data[5];
+
+	return true;
+}
+
+/**
+ * @brief Returns the address of the first byte of a slot
+ */
+uint16_t CycleLog::address(uint16_t slot) const {
+	return _start + slot * SLOT_SIZE;
+}
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of a buffer
+ *
+ * With this init value neither an erased (0xFF) nor a zeroed slot is valid.
+ */
+uint16_t CycleLog::crc(const uint8_t *data, uint8_t length) {
+	uint16_t crc = 0xFFFF;
+
+	for (uint8_t i = 0; i < length; ++i) {
+		crc ^= (uint16_t) data[i] << 8;
+		for (uint8_t bit = 0; bit < 8; ++bit) {
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+
+	return crc;
+}
@@ -0,0 +1,82 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_ARDUINO_CLASS_CYCLE_LOG_H_
+#define LEKA_ARDUINO_CLASS_CYCLE_LOG_H_
+
+/**
+ * @file CycleLog.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * The log is a circular array of 8 bytes slots, each commit writes the next slot:
+ *   sequence (2 bytes) | cycle (3 bytes) | result (1 byte) | CRC-16/CCITT of the 6 previous bytes (2 bytes)
+ *
+ * All values are little endian. The CRC is written last, so a commit interrupted
+ * by a power loss leaves a slot that fails the CRC and the previous commit is used.
+ * Each cell is written once every capacity() commits.
+ */
+
+#include <Arduino.h>
+#include "IEeprom.h"
+
+struct CycleRecord {
+	uint16_t sequence;
+	uint32_t cycle;
+	uint8_t result;
+};
+
+/**
+ * @class CycleLog
+ * @brief Wear-levelled log of the cycle counter and per-cycle results
+ */
+
+class CycleLog {
+	public:
+		CycleLog(IEeprom &eeprom, uint16_t start, uint16_t length);
+
+		bool restore(void);
+		void commit(uint32_t cycle, uint8_t result);
+
+		bool isEmpty(void) const;
+		uint32_t cycle(void) const;
+		uint8_t result(void) const;
+		bool read(uint16_t age, CycleRecord &record);
+
+		uint16_t capacity(void) const;
+
+		static const uint8_t  SLOT_SIZE = 8;
+		static const uint32_t MAX_CYCLE = 0xFFFFFF;
+
+	private:
+		bool readSlot(uint16_t slot, CycleRecord &record);
+		uint16_t address(uint16_t slot) const;
+
+		static uint16_t crc(const uint8_t *data, uint8_t length);
+
+		IEeprom &_eeprom;
+		uint16_t _start;
+		uint16_t _slots;
+
+		bool _empty;
+		uint16_t _last;
+		CycleRecord _record;
+};
+
+#endif
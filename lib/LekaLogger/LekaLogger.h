@@ -40,7 +40,7 @@
 #define __FILENAME__ (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
 #ifndef LOG_BUFFER_SIZE
-#define LOG_BUFFER_SIZE       128 // start with 64 and if you notice strange characters use a larger buffer
+#define LOG_BUFFER_SIZE       128 // longer messages are truncated to LOG_BUFFER_SIZE - 1 characters
 #endif
 
 #ifndef outputLevel
@@ -126,14 +126,14 @@ namespace LekaLogger {
 
 		int free_memory;
 
-		if ((int)__brkval == 0) {
+		if (__brkval == 0) {
 
-			free_memory = ((int)&free_memory) - ((int)&__heap_start);
+			free_memory = (int)((intptr_t)&free_memory - (intptr_t)&__heap_start);
 
 		}
 		else {
 
-			free_memory = ((int)&free_memory) - ((int)__brkval);
+			free_memory = (int)((intptr_t)&free_memory - (intptr_t)__brkval);
 			free_memory += freeListSize();
 
 		}
@@ -187,8 +187,9 @@ namespace LekaLogger {
 		LekaLogger::ms   = LekaLogger::currentTime % 1000;
 		LekaLogger::sec  = (LekaLogger::currentTime / 1000);
 		LekaLogger::min  = (LekaLogger::sec / 60) % 60;
-		LekaLogger::hour = (LekaLogger::min / 60);
-		sprintf(LekaLogger::buffer,
+		LekaLogger::hour = (LekaLogger::sec / 3600);
+		snprintf(LekaLogger::buffer,
+				LOG_BUFFER_SIZE,
 				"%04lu:%02lu:%02lu:%03lu",
 				LekaLogger::hour,
 				LekaLogger::min,
@@ -326,7 +327,7 @@ namespace LekaLogger {
 		}                                                       \
 	}                                                           \
 	_log_showArrowSeparator;                                    \
-	sprintf(LekaLogger::buffer, str __VA_OPT__(,) __VA_ARGS__); \
+	snprintf(LekaLogger::buffer, LOG_BUFFER_SIZE, str __VA_OPT__(,) __VA_ARGS__); \
 	Serial.print(LekaLogger::buffer);                         \
 } while(0) // define printMessage()
 
@@ -347,17 +348,17 @@ namespace LekaLogger {
 		}                                                       \
 	}                                                           \
 	_log_showArrowSeparator;                                    \
-	sprintf(LekaLogger::buffer, str __VA_OPT__(,) __VA_ARGS__); \
+	snprintf(LekaLogger::buffer, LOG_BUFFER_SIZE, str __VA_OPT__(,) __VA_ARGS__); \
 	Serial.println(LekaLogger::buffer);                         \
 } while(0) // define printMessage()
 
 #define printAppendMessage(str, ...) do {                        \
-	sprintf(LekaLogger::buffer, str __VA_OPT__(,) __VA_ARGS__); \
+	snprintf(LekaLogger::buffer, LOG_BUFFER_SIZE, str __VA_OPT__(,) __VA_ARGS__); \
 	Serial.print(LekaLogger::buffer);                         \
 } while(0) // define printMessage()
 
 #define printlnAppendMessage(str, ...) do {                        \
-	sprintf(LekaLogger::buffer, str __VA_OPT__(,) __VA_ARGS__); \
+	snprintf(LekaLogger::buffer, LOG_BUFFER_SIZE, str __VA_OPT__(,) __VA_ARGS__); \
 	Serial.println(LekaLogger::buffer);                         \
 } while(0) // define printMessage()
 
@@ -422,11 +423,11 @@ namespace LekaLogger {
 } while(0)
 
 #define log_append(str, ...) do {                                        \
-	printAppendMessage(str, __VA_OPT__(,) __VA_ARGS__); \
+	printAppendMessage(str __VA_OPT__(,) __VA_ARGS__); \
 } while(0)
 
 #define logln_append(str, ...) do {                                        \
-	printlnAppendMessage(str, __VA_OPT__(,) __VA_ARGS__); \
+	printlnAppendMessage(str __VA_OPT__(,) __VA_ARGS__); \
 } while(0)
 
 #else // DEBUG_IS_OFF
@@ -444,6 +445,9 @@ namespace LekaLogger {
 #define logln_warning(str, ...)
 #define logln_error(str, ...)
 
+#define log_append(str, ...)
+#define logln_append(str, ...)
+
 #endif // DEBUG_IS_ON or DEBUG_IS_OFF
 
 #endif // _LEKA_LOGGER_H_
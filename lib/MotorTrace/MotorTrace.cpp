@@ -0,0 +1,433 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <Arduino.h>
+#include "MotorTrace.h"
+
+
+/**
+ * @file MotorTrace.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+static_assert(MotorTrace::BUFFER_SIZE <= MotorTrace::MAX_FRAME_LENGTH, "the whole ring must fit in one frame");
+
+//
+// Mark:- MotorTrace
+//
+
+/**
+ * @brief Instantiates a new empty trace
+ */
+MotorTrace::MotorTrace(void) {
+	_head = 0;
+	_tail = 0;
+	_count = 0;
+	_lastTime = 0;
+	_tailTime = 0;
+	_dropped = 0;
+}
+
+/**
+ * @brief Sets the time reference of the first recorded command
+ */
+void MotorTrace::begin(void) {
+	uint8_t oldSREG = SREG;
+	cli();
+	_lastTime = millis();
+	_tailTime = _lastTime;
+	SREG = oldSREG;
+}
+
+/**
+ * @brief Appends a motor command to the ring, safe to call from an interrupt
+ * @param motor the id of the motor (0-127)
+ * @param rotation the direction of the command
+ * @param speed the speed of the command
+ * @return false if the ring is full and the command was dropped
+ */
+bool MotorTrace::record(uint8_t motor, Rotation rotation, uint8_t speed) {
+	uint8_t oldSREG = SREG;
+	cli();
+
+	if (BUFFER_SIZE - _count < MAX_RECORD_SIZE) {
+		// Keep _lastTime untouched so that the next delta still spans the gap
+		if (_dropped < 0xFFFF) {
+			_dropped++;
+		}
+		SREG = oldSREG;
+		return false;
+	}
+
+	unsigned long now = millis();
+	// millis() is 32 bits on the target, this keeps the varint within MAX_RECORD_SIZE on 64 bits hosts too
+	uint32_t delta = (uint32_t) (now - _lastTime);
+	_lastTime = now;
+
+	uint8_t record[MAX_RECORD_SIZE];
+	uint8_t length = 0;
+
+	do {
+		uint8_t byte = delta & 0x7F;
+		delta >>= 7;
+		record[length++] = delta != 0 ? (byte | 0x80) : byte;
+	} while (delta != 0);
+
+	record[length++] = (uint8_t) (motor << 1) | (uint8_t) rotation;
+	record[length++] = speed;
+
+	for (uint8_t i = 0; i < length; ++i) {
+		_buffer[_head] = record[i];
+		_head = (_head + 1) % BUFFER_SIZE;
+	}
+	_count += length;
+
+	SREG = oldSREG;
+	return true;
+}
+
+/**
+ * @brief Writes all recorded commands as one binary frame and empties the ring
+ * @param output where to write the frame, i.e. Serial1
+ *
+ * Interrupts are only disabled to snapshot and release the ring, records
+ * added while writing are kept for the next flush.
+ */
+void MotorTrace::flush(Print &output) {
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t length = _count;
+	// More than 255 drops are reported over several frames
+	uint8_t dropped = _dropped > 0xFF ? 0xFF : _dropped;
+	_dropped -= dropped;
+	unsigned long time = _tailTime;
+	SREG = oldSREG;
+
+	if (length == 0 && dropped == 0) {
+		return;
+	}
+
+	// The records of the snapshot are not touched by record(), walk them to find
+	// the time of the first one for the header and of the last one for the next frame
+	uint16_t position = _tail;
+	uint16_t read = 0;
+	uint32_t firstTime = time;
+
+	while (read < length) {
+		uint32_t delta = 0;
+		uint8_t shift = 0;
+		uint8_t byte;
+
+		do {
+			byte = _buffer[position];
+			delta |= (uint32_t) (byte & 0x7F) << shift;
+			shift += 7;
+			position = (position + 1) % BUFFER_SIZE;
+		} while (byte & 0x80);
+
+		time += delta;
+		if (read == 0) {
+			firstTime = time;
+		}
+
+		read += shift / 7 + 2;
+		position = (position + 2) % BUFFER_SIZE;
+	}
+
+	uint8_t header[FRAME_HEADER_SIZE];
+	header[0] = (uint8_t) length;
+	header[1] = dropped;
+	header[2] = firstTime & 0xFF;
+	header[3] = (firstTime >> 8) & 0xFF;
+	header[4] = (firstTime >> 16) & 0xFF;
+	header[5] = (firstTime >> 24) & 0xFF;
+
+	uint8_t sum = 0;
+
+	output.write(FRAME_SYNC);
+	for (uint8_t i = 0; i < FRAME_HEADER_SIZE; ++i) {
+		output.write(header[i]);
+		sum += header[i];
+	}
+
+	position = _tail;
+	for (uint16_t i = 0; i < length; ++i) {
+		uint8_t byte = _buffer[position];
+		output.write(byte);
+		sum += byte;
+		position = (position + 1) % BUFFER_SIZE;
+	}
+
+	output.write(sum);
+
+	oldSREG = SREG;
+	cli();
+	_tail = position;
+	_tailTime = time;
+	_count -= length;
+	SREG = oldSREG;
+}
+
+/**
+ * @brief Returns the number of bytes waiting to be flushed
+ */
+uint16_t MotorTrace::available(void) const {
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t count = _count;
+	SREG = oldSREG;
+	return count;
+}
+
+/**
+ * @brief Returns the number of dropped commands not reported in a frame yet
+ */
+uint16_t MotorTrace::dropped(void) const {
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t dropped = _dropped;
+	SREG = oldSREG;
+	return dropped;
+}
+
+
+//
+// Mark:- MotorTraceDecoder
+//
+
+/**
+ * @brief Instantiates a new decoder
+ * @param callback called for each decoded command, with the absolute millis() of the recorder
+ * @param context passed as is to the callback
+ */
+MotorTraceDecoder::MotorTraceDecoder(Callback callback, void *context) {
+	_callback = callback;
+	_context = context;
+
+	_state = State::sync;
+	_size = 0;
+	_sum = 0;
+
+	_commands = 0;
+	_dropped = 0;
+	_errors = 0;
+}
+
+/**
+ * @brief Feeds one byte of the stream, invalid frames are skipped until the next sync byte
+ * @param byte the next byte of the stream
+ *
+ * A corrupted length byte can make a rejected frame swallow the SYNC of the
+ * next one, so every byte received after the rejected SYNC is scanned again.
+ */
+void MotorTraceDecoder::decode(uint8_t byte) {
+	if (!consume(byte)) {
+		rescan();
+	}
+}
+
+/**
+ * @brief Tells the decoder that the stream has ended
+ *
+ * A frame still incomplete at the end of the stream is counted as an error
+ * and the bytes received after its SYNC are scanned again, as a fake SYNC
+ * in a corrupted frame can hide the valid frames following it.
+ */
+void MotorTraceDecoder::finish(void) {
+	while (_state != State::sync) {
+		_errors++;
+		_state = State::sync;
+		rescan();
+	}
+}
+
+/**
+ * @brief Scans again the bytes received after the SYNC of a rejected frame
+ */
+void MotorTraceDecoder::rescan(void) {
+	uint16_t size = _size;
+	memcpy(_rescan, _frame, size);
+
+	uint16_t position = 0;
+	uint16_t start = 0;
+
+	while (position < size) {
+		uint8_t next = _rescan[position++];
+
+		if (_state == State::sync && next == MotorTrace::FRAME_SYNC) {
+			start = position;
+		}
+
+		if (!consume(next)) {
+			position = start;
+		}
+	}
+}
+
+/**
+ * @brief Advances the frame state machine by one byte
+ * @param byte the next byte of the stream
+ * @return false if the byte completes a frame whose checksum does not match
+ */
+bool MotorTraceDecoder::consume(uint8_t byte) {
+	switch (_state) {
+		case State::sync:
+			if (byte == MotorTrace::FRAME_SYNC) {
+				_size = 0;
+				_sum = 0;
+				_state = State::header;
+			}
+			break;
+
+		case State::header:
+			_frame[_size++] = byte;
+			_sum += byte;
+			if (_size == MotorTrace::FRAME_HEADER_SIZE) {
+				_state = _frame[0] != 0 ? State::payload : State::checksum;
+			}
+			break;
+
+		case State::payload:
+			_frame[_size++] = byte;
+			_sum += byte;
+			if (_size == MotorTrace::FRAME_HEADER_SIZE + _frame[0]) {
+				_state = State::checksum;
+			}
+			break;
+
+		case State::checksum:
+			_frame[_size++] = byte;
+			_state = State::sync;
+			if (byte != _sum) {
+				_errors++;
+				return false;
+			}
+			_dropped += _frame[1];
+			parseFrame();
+			break;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Decodes the records of a valid frame and reports them to the callback
+ */
+void MotorTraceDecoder::parseFrame(void) {
+	uint8_t length = _frame[0];
+	const uint8_t *payload = _frame + MotorTrace::FRAME_HEADER_SIZE;
+
+	unsigned long time = _frame[2] | (uint32_t) _frame[3] << 8 | (uint32_t) _frame[4] << 16 | (uint32_t) _frame[5] << 24;
+	uint8_t position = 0;
+	bool first = true;
+
+	while (position < length) {
+		unsigned long delta = 0;
+		uint8_t shift = 0;
+		uint8_t byte;
+
+		do {
+			if (position >= length || shift > 28) {
+				_errors++;
+				return;
+			}
+			byte = payload[position++];
+			delta |= (unsigned long) (byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+
+		if (position + 2 > length) {
+			_errors++;
+			return;
+		}
+
+		// The time of the first record is in the header
+		if (!first) {
+			time += delta;
+		}
+		first = false;
+
+		MotorCommand command;
+		command.time = time;
+		command.motor = payload[position] >> 1;
+		command.rotation = (Rotation) (payload[position] & 0x01);
+		command.speed = payload[position + 1];
+		position += 2;
+
+		_commands++;
+		_callback(command, _context);
+	}
+}
+
+/**
+ * @brief Returns the number of commands decoded so far
+ */
+unsigned long MotorTraceDecoder::commands(void) const {
+	return _commands;
+}
+
+/**
+ * @brief Returns the number of commands the recorder reported as dropped
+ */
+unsigned long MotorTraceDecoder::dropped(void) const {
+	return _dropped;
+}
+
+/**
+ * @brief Returns the number of frames or records rejected as invalid
+ */
+unsigned long MotorTraceDecoder::errors(void) const {
+	return _errors;
+}
+
+
+//
+// Mark:- TracedMotor
+//
+
+/**
+ * @brief Instantiates a new traced motor
+ * @param motor the motor receiving the commands
+ * @param id the id of the motor in the trace
+ * @param trace the trace recording the commands
+ */
+TracedMotor::TracedMotor(IMotor &motor, uint8_t id, MotorTrace &trace) : _motor(motor), _id(id), _trace(trace) {
+}
+
+/**
+ * @brief Records the command, then spins the wrapped motor
+ * @param rotation the direction to spin
+ * @param speed the speed to spin
+ */
+void TracedMotor::spin(Rotation rotation, uint8_t speed) {
+	_trace.record(_id, rotation, speed);
+	_motor.spin(rotation, speed);
+}
+
+/**
+ * @brief Stops the wrapped motor, then records the command
+ *
+ * The safety supervisor stops the motors from an interrupt, the pins
+ * must change before the time spent recording.
+ */
+void TracedMotor::stop(void) {
+	_motor.stop();
+	_trace.record(_id, Rotation::clockwise, 0);
+}
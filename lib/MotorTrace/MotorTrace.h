@@ -0,0 +1,150 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_ARDUINO_CLASS_MOTOR_TRACE_H_
+#define LEKA_ARDUINO_CLASS_MOTOR_TRACE_H_
+
+/**
+ * @file MotorTrace.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Each motor command is recorded as:
+ *   - the time since the previous command in ms, as a varint (7 bits per byte, MSB set if more bytes follow)
+ *   - one byte with the motor id in bits 7..1 and the rotation in bit 0
+ *   - one byte with the speed
+ *
+ * The ring is streamed out in frames:
+ *   SYNC (0xA5) | length | dropped | time (4 bytes, little endian) | payload (whole records) | checksum
+ *
+ * dropped is the number of records lost since the previous frame because the ring was full,
+ * time is the absolute millis() of the first record of the frame, whose delta is then ignored,
+ * checksum is the 8-bit sum of all bytes after SYNC.
+ *
+ * As each frame carries its own time, a lost or corrupted frame only loses its own records.
+ */
+
+#include <Arduino.h>
+#include "IMotor.h"
+
+struct MotorCommand {
+	unsigned long time;
+	uint8_t motor;
+	Rotation rotation;
+	uint8_t speed;
+};
+
+/**
+ * @class MotorTrace
+ * @brief Records motor commands in a small RAM ring and streams them out as binary frames
+ */
+
+class MotorTrace {
+	public:
+		MotorTrace(void);
+
+		void begin(void);
+		bool record(uint8_t motor, Rotation rotation, uint8_t speed);
+		void flush(Print &output);
+
+		uint16_t available(void) const;
+		uint16_t dropped(void) const;
+
+		static const uint16_t BUFFER_SIZE       = 128;
+		static const uint8_t  MAX_RECORD_SIZE   = 7;
+		static const uint8_t  MAX_FRAME_LENGTH  = 255;
+		static const uint8_t  FRAME_HEADER_SIZE = 6;
+		static const uint8_t  FRAME_SYNC        = 0xA5;
+
+	private:
+		uint8_t _buffer[BUFFER_SIZE];
+		uint16_t _head;
+		uint16_t _tail;
+		uint16_t _count;
+
+		unsigned long _lastTime;
+		unsigned long _tailTime;
+		uint16_t _dropped;
+};
+
+/**
+ * @class MotorTraceDecoder
+ * @brief Parses a stream of MotorTrace frames back into motor commands
+ */
+
+class MotorTraceDecoder {
+	public:
+		typedef void (*Callback)(const MotorCommand &command, void *context);
+
+		MotorTraceDecoder(Callback callback, void *context = nullptr);
+
+		void decode(uint8_t byte);
+		void finish(void);
+
+		unsigned long commands(void) const;
+		unsigned long dropped(void) const;
+		unsigned long errors(void) const;
+
+	private:
+		enum class State : uint8_t {
+			sync,
+			header,
+			payload,
+			checksum
+		};
+
+		static const uint16_t MAX_FRAME_SIZE = MotorTrace::FRAME_HEADER_SIZE + MotorTrace::MAX_FRAME_LENGTH + 1;
+
+		bool consume(uint8_t byte);
+		void rescan(void);
+		void parseFrame(void);
+
+		Callback _callback;
+		void *_context;
+
+		State _state;
+		uint8_t _frame[MAX_FRAME_SIZE];
+		uint8_t _rescan[MAX_FRAME_SIZE];
+		uint16_t _size;
+		uint8_t _sum;
+
+		unsigned long _commands;
+		unsigned long _dropped;
+		unsigned long _errors;
+};
+
+/**
+ * @class TracedMotor
+ * @brief Records every command sent to the wrapped motor in a MotorTrace
+ */
+
+class TracedMotor : public IMotor {
+	public:
+		TracedMotor(IMotor &motor, uint8_t id, MotorTrace &trace);
+
+		void spin(Rotation rotation, uint8_t speed);
+		void stop(void);
+
+	private:
+		IMotor &_motor;
+		uint8_t _id;
+		MotorTrace &_trace;
+};
+
+#endif
@@ -0,0 +1,275 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <Arduino.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include "SafetySupervisor.h"
+
+
+/**
+ * @file SafetySupervisor.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+// Only one supervisor can own the watchdog interrupt
+static SafetySupervisor * _supervisor = nullptr;
+
+#if defined(__AVR__)
+// Written in .init3, before .bss is cleared
+static uint8_t _resetFlags __attribute__((section(".noinit")));
+void saveResetFlags(void) __attribute__((naked, used, section(".init3")));
+#else
+static uint8_t _resetFlags = 0;
+void saveResetFlags(void);
+#endif
+
+/**
+ * @brief Saves and clears the reset flags, then disables the watchdog
+ *
+ * After a watchdog reset the watchdog keeps running with its 15ms timeout,
+ * the C runtime and the global constructors can take longer than that, so
+ * this runs from .init3, right after the bootloader. A bootloader clearing
+ * MCUSR itself still hides the watchdog reset from wasWatchdogReset().
+ */
+void saveResetFlags(void) {
+	_resetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+/**
+ * @brief Instantiates a new supervisor
+ */
+SafetySupervisor::SafetySupervisor(void) {
+	_motorCount = 0;
+
+	_stallThreshold = 0;
+	_overcurrentThreshold = 0;
+	_stallTicks = 0;
+
+	_timeoutTicks = 0;
+	_ticksSinceFeed = 0;
+
+	_fault = Fault::none;
+	_faultedMotor = NO_MOTOR;
+	_reactionTime = 0;
+
+#if !defined(__AVR__)
+	// There is no startup code on the host, run it here
+	saveResetFlags();
+#endif
+}
+
+/**
+ * @brief Adds a motor to the list of motors stopped on fault
+ * @param motor the motor to supervise
+ * @param currentPin the analog pin reading the motor current, NO_CURRENT_SENSE if none
+ */
+void SafetySupervisor::attach(IMotor &motor, uint8_t currentPin) {
+	if (_motorCount >= MAX_MOTORS) {
+		return;
+	}
+
+	_motors[_motorCount] = &motor;
+	_currentPins[_motorCount] = currentPin;
+	_stallCounts[_motorCount] = 0;
+	_motorCount++;
+}
+
+/**
+ * @brief Sets the current sense limits, in raw analogRead() units
+ * @param stallThreshold current above which the motor is considered stalled
+ * @param overcurrentThreshold current above which the motor is stopped immediately
+ * @param stallTicks number of consecutive checks above stallThreshold before tripping
+ */
+void SafetySupervisor::setCurrentLimits(uint16_t stallThreshold, uint16_t overcurrentThreshold, uint8_t stallTicks) {
+	_stallThreshold = stallThreshold;
+	_overcurrentThreshold = overcurrentThreshold;
+	_stallTicks = stallTicks;
+}
+
+/**
+ * @brief Starts the watchdog in interrupt + system reset mode
+ * @param commandTimeout maximum time in ms allowed between two calls to feed()
+ */
+void SafetySupervisor::begin(uint16_t commandTimeout) {
+	_timeoutTicks = commandTimeout / CHECK_PERIOD_MS + 1;
+	_supervisor = this;
+
+	feed();
+
+	uint8_t oldSREG = SREG;
+	cli();
+	wdt_reset();
+	wdt_enable(WDTO_15MS);
+	WDTCSR |= _BV(WDIE);
+	SREG = oldSREG;
+}
+
+/**
+ * @brief Tells the supervisor that the main loop is still alive
+ */
+void SafetySupervisor::feed(void) {
+	uint8_t oldSREG = SREG;
+	cli();
+	_ticksSinceFeed = 0;
+	SREG = oldSREG;
+}
+
+/**
+ * @brief Spins a motor unless a fault has been latched
+ * @param motor the motor to spin
+ * @param rotation the direction to spin
+ * @param speed the speed to spin
+ *
+ * The fault check and the command are done with interrupts disabled so
+ * that a command can never restart a motor the interrupt just stopped.
+ */
+void SafetySupervisor::spin(IMotor &motor, Rotation rotation, uint8_t speed) {
+	uint8_t oldSREG = SREG;
+	cli();
+	if (_fault == Fault::none) {
+		motor.spin(rotation, speed);
+	}
+	SREG = oldSREG;
+}
+
+/**
+ * @brief Runs one supervision step, called from the watchdog interrupt
+ *
+ * Each current sense is read with a blocking analogRead(), about 112us per
+ * motor with interrupts disabled, MAX_MOTORS * 112us at most per check.
+ * The reaction time of a current fault starts with the read of the faulted
+ * motor, so it does not include the reads of the motors checked before it.
+ */
+void SafetySupervisor::check(void) {
+	if (_fault != Fault::none) {
+		return;
+	}
+
+	if (++_ticksSinceFeed > _timeoutTicks) {
+		trip(Fault::commandTimeout, NO_MOTOR, micros());
+		return;
+	}
+
+	for (uint8_t i = 0; i < _motorCount; ++i) {
+		if (_currentPins[i] == NO_CURRENT_SENSE) {
+			continue;
+		}
+
+		unsigned long detectedAt = micros();
+		uint16_t current = analogRead(_currentPins[i]);
+
+		if (_overcurrentThreshold != 0 && current >= _overcurrentThreshold) {
+			trip(Fault::overcurrent, i, detectedAt);
+			return;
+		}
+
+		if (_stallThreshold != 0 && current >= _stallThreshold) {
+			if (++_stallCounts[i] >= _stallTicks) {
+				trip(Fault::stall, i, detectedAt);
+				return;
+			}
+		}
+		else {
+			_stallCounts[i] = 0;
+		}
+	}
+}
+
+/**
+ * @brief Stops every motor and latches the fault
+ * @param fault the reason of the fault
+ * @param motor the index of the faulted motor, NO_MOTOR if not motor specific
+ * @param detectedAt the micros() timestamp at which the faulty check started
+ */
+void SafetySupervisor::trip(Fault fault, uint8_t motor, unsigned long detectedAt) {
+	for (uint8_t i = 0; i < _motorCount; ++i) {
+		_motors[i]->stop();
+	}
+
+	_reactionTime = micros() - detectedAt;
+	_faultedMotor = motor;
+	_fault = fault;
+}
+
+/**
+ * @brief Returns true once a fault has been latched
+ */
+bool SafetySupervisor::hasFaulted(void) const {
+	return _fault != Fault::none;
+}
+
+/**
+ * @brief Returns the latched fault
+ */
+Fault SafetySupervisor::fault(void) const {
+	return _fault;
+}
+
+/**
+ * @brief Returns the index of the faulted motor, NO_MOTOR if not motor specific
+ */
+uint8_t SafetySupervisor::faultedMotor(void) const {
+	return _faultedMotor;
+}
+
+/**
+ * @brief Returns the time in us between the start of the faulty check and all motors stopped
+ *
+ * For a current fault the check starts with the current read of the faulted motor.
+ */
+unsigned long SafetySupervisor::reactionTime(void) const {
+	uint8_t oldSREG = SREG;
+	cli();
+	unsigned long reactionTime = _reactionTime;
+	SREG = oldSREG;
+	return reactionTime;
+}
+
+/**
+ * @brief Returns true if the last reset was caused by the watchdog
+ */
+bool SafetySupervisor::wasWatchdogReset(void) const {
+	return _resetFlags & _BV(WDRF);
+}
+
+/**
+ * @brief Returns a printable name for a fault
+ * @param fault the fault to name
+ */
+const char * SafetySupervisor::faultName(Fault fault) {
+	switch (fault) {
+		case Fault::commandTimeout: return "command timeout";
+		case Fault::stall:          return "stall";
+		case Fault::overcurrent:    return "overcurrent";
+		default:                    return "none";
+	}
+}
+
+ISR(WDT_vect) {
+	// The hardware clears WDIE on each interrupt, set it back to stay out of the reset
+	WDTCSR |= _BV(WDIE);
+
+	if (_supervisor != nullptr) {
+		_supervisor->check();
+	}
+}
@@ -0,0 +1,101 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_ARDUINO_CLASS_SAFETY_SUPERVISOR_H_
+#define LEKA_ARDUINO_CLASS_SAFETY_SUPERVISOR_H_
+
+/**
+ * @file SafetySupervisor.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+#include <Arduino.h>
+#include "IMotor.h"
+
+enum class Fault : uint8_t {
+	none           = 0,
+	commandTimeout = 1,
+	stall          = 2,
+	overcurrent    = 3
+};
+
+/**
+ * @class SafetySupervisor
+ * @brief Stops every attached motor from the watchdog interrupt when a fault is detected.
+ *
+ * The AVR watchdog runs in interrupt + system reset mode with a 15ms period.
+ * Each watchdog interrupt checks the command timeout and the current sense
+ * of each motor. On the first fault, every motor is stopped from the
+ * interrupt and the fault is latched until the next reset. If the
+ * interrupt itself cannot run (interrupts disabled for too long), the
+ * watchdog resets the board, which also releases the motor pins.
+ *
+ * The current is read with analogRead() from the interrupt, which blocks
+ * for about 112us per sensed motor, 448us at most with MAX_MOTORS. As
+ * analogRead() is not reentrant, the rest of the program must not use the
+ * ADC once begin() has been called.
+ */
+
+class SafetySupervisor {
+	public:
+		SafetySupervisor(void);
+
+		void attach(IMotor &motor, uint8_t currentPin = NO_CURRENT_SENSE);
+		void setCurrentLimits(uint16_t stallThreshold, uint16_t overcurrentThreshold, uint8_t stallTicks);
+		void begin(uint16_t commandTimeout);
+
+		void feed(void);
+		void spin(IMotor &motor, Rotation rotation, uint8_t speed);
+		void check(void);
+
+		bool hasFaulted(void) const;
+		Fault fault(void) const;
+		uint8_t faultedMotor(void) const;
+		unsigned long reactionTime(void) const;
+		bool wasWatchdogReset(void) const;
+
+		static const char * faultName(Fault fault);
+
+		static const uint8_t MAX_MOTORS        = 4;
+		static const uint8_t NO_CURRENT_SENSE  = 0xFF;
+		static const uint8_t NO_MOTOR          = 0xFF;
+		static const uint8_t CHECK_PERIOD_MS   = 16;
+
+	private:
+		void trip(Fault fault, uint8_t motor, unsigned long detectedAt);
+
+		IMotor * _motors[MAX_MOTORS];
+		uint8_t _currentPins[MAX_MOTORS];
+		uint8_t _stallCounts[MAX_MOTORS];
+		uint8_t _motorCount;
+
+		uint16_t _stallThreshold;
+		uint16_t _overcurrentThreshold;
+		uint8_t _stallTicks;
+
+		uint16_t _timeoutTicks;
+		volatile uint16_t _ticksSinceFeed;
+
+		volatile Fault _fault;
+		volatile uint8_t _faultedMotor;
+		volatile unsigned long _reactionTime;
+};
+
+#endif
@@ -7,14 +7,23 @@
 
 
 #include <Arduino.h>
+#include "AvrEeprom.h"
+#include "CycleLog.h"
 #include "IMotor.h"
 #include "Motor.h"
 #include "LekaLogger.h"
+#include "MotorTrace.h"
+#include "SafetySupervisor.h"
+
+const uint8_t MOTOR_LEFT_ID             = 0;
+const uint8_t MOTOR_RIGHT_ID            = 1;
 
 const uint8_t MOTOR_LEFT_DIRECTION_PIN  = 4;
 const uint8_t MOTOR_LEFT_SPEED_PIN      = 5;
 const uint8_t MOTOR_RIGHT_DIRECTION_PIN = 7;
 const uint8_t MOTOR_RIGHT_SPEED_PIN     = 6;
+const uint8_t MOTOR_LEFT_CURRENT_PIN    = A0;
+const uint8_t MOTOR_RIGHT_CURRENT_PIN   = A1;
 
 const uint8_t MOTOR_MAX_SPEED           = (uint8_t) 255 * 90 / 100;
 
@@ -22,20 +31,39 @@ const int     ACCLERATION_DURATION_MS   = 2000;
 const int     ACCLERATION_STEP_MS       = 100;
 const int     MOVEMENT_DURATION_MS      = 30'000;
 
-Motor motorLeft   = Motor(MOTOR_LEFT_DIRECTION_PIN, MOTOR_LEFT_SPEED_PIN);
-Motor motorRight  = Motor(MOTOR_RIGHT_DIRECTION_PIN, MOTOR_RIGHT_SPEED_PIN);
+const uint16_t CYCLE_LOG_START           = 0;
+const uint16_t CYCLE_LOG_LENGTH          = E2END + 1;
+
+const uint16_t SAFETY_COMMAND_TIMEOUT_MS = 1000;
+const uint16_t SAFETY_STALL_CURRENT      = 600;
+const uint16_t SAFETY_OVERCURRENT        = 900;
+const uint8_t  SAFETY_STALL_TICKS        = 32;
+
+Motor motorLeftDriver   = Motor(MOTOR_LEFT_DIRECTION_PIN, MOTOR_LEFT_SPEED_PIN);
+Motor motorRightDriver  = Motor(MOTOR_RIGHT_DIRECTION_PIN, MOTOR_RIGHT_SPEED_PIN);
+
+// Every command sent to motorLeft/motorRight is recorded and streamed to TRACE_SERIAL
+#define TRACE_SERIAL Serial1
+MotorTrace motorTrace;
+TracedMotor motorLeft   = TracedMotor(motorLeftDriver, MOTOR_LEFT_ID, motorTrace);
+TracedMotor motorRight  = TracedMotor(motorRightDriver, MOTOR_RIGHT_ID, motorTrace);
+
+SafetySupervisor safety;
+AvrEeprom eeprom;
+CycleLog cycleLog = CycleLog(eeprom, CYCLE_LOG_START, CYCLE_LOG_LENGTH);
+bool faultReported = false;
 
 unsigned long cycle = 1;
 
 void moveForward(uint8_t speed) {
 	// log_append(".");
-	motorRight.spin(Rotation::clockwise, speed);
-	motorLeft.spin(Rotation::counterClockwise, speed);
+	safety.spin(motorRight, Rotation::clockwise, speed);
+	safety.spin(motorLeft, Rotation::counterClockwise, speed);
 }
 
 void moveBackward(uint8_t speed) {
-	motorRight.spin(Rotation::counterClockwise, speed);
-	motorLeft.spin(Rotation::clockwise, speed);
+	safety.spin(motorRight, Rotation::counterClockwise, speed);
+	safety.spin(motorLeft, Rotation::clockwise, speed);
 }
 
 void stop() {
@@ -49,8 +77,17 @@ void accelerate(void (*moveBackwardOrForward)(uint8_t), int duration, int stepDu
 	int remainingTime = duration % stepDuration;
 
 	for (auto i = 0; i < steps; ++i) {
+		if (safety.hasFaulted()) {
+			logln_append("");
+			return;
+		}
 		auto currentSpeed = speed / steps * i;
 		moveBackwardOrForward(currentSpeed);
+		safety.feed();
+		// A step only records a few bytes, flush them in batches to keep the framing small
+		if (motorTrace.available() > MotorTrace::BUFFER_SIZE / 2) {
+			motorTrace.flush(TRACE_SERIAL);
+		}
 		delay(stepDuration);
 		log_append(".");
 	}
@@ -74,11 +111,19 @@ void waitFor(int duration) {
 	int remainingTime = duration % stepDuration;
 
 	for (int i = 0; i < steps; ++i) {
+		if (safety.hasFaulted()) {
+			logln_append("");
+			return;
+		}
+		safety.feed();
+		motorTrace.flush(TRACE_SERIAL);
 		delay(stepDuration);
 		log_append(".");
 	}
 
 	if (remainingTime != 0) {
+		safety.feed();
+		motorTrace.flush(TRACE_SERIAL);
 		delay(remainingTime);
 		logln_append(".");
 	}
@@ -88,9 +133,51 @@ void waitFor(int duration) {
 
 }
 
+bool hasFaulted() {
+
+	if (!safety.hasFaulted()) {
+		return false;
+	}
+
+	if (!faultReported) {
+		// Motors are already stopped by the watchdog interrupt, it is now safe to take time to log
+		logln_error("[Safety] - Cycle %04ld - Fault: %s - Motor: %u - Motors stopped in %luus",
+				cycle,
+				SafetySupervisor::faultName(safety.fault()),
+				safety.faultedMotor(),
+				safety.reactionTime());
+		motorTrace.flush(TRACE_SERIAL);
+		cycleLog.commit(cycle, (uint8_t) safety.fault());
+		faultReported = true;
+	}
+
+	return true;
+
+}
+
 void setup() {
 	Serial.begin(115200);
+	TRACE_SERIAL.begin(115200);
 	delay(1000);
+
+	if (cycleLog.restore()) {
+		cycle = cycleLog.cycle() + 1;
+		logln_info("[CycleLog] - Resume at cycle %04ld - Last cycle result: %s",
+				cycle,
+				SafetySupervisor::faultName((Fault) cycleLog.result()));
+	}
+
+	if (safety.wasWatchdogReset()) {
+		logln_warning("[Safety] - Restarted by the hardware watchdog");
+	}
+
+	safety.attach(motorLeft, MOTOR_LEFT_CURRENT_PIN);
+	safety.attach(motorRight, MOTOR_RIGHT_CURRENT_PIN);
+	safety.setCurrentLimits(SAFETY_STALL_CURRENT, SAFETY_OVERCURRENT, SAFETY_STALL_TICKS);
+	safety.begin(SAFETY_COMMAND_TIMEOUT_MS);
+
+	motorTrace.begin();
+
 	log_info("Starting Motor Resistance Test");
 	waitFor(5000);
 	Serial.println("");
@@ -98,30 +185,41 @@ void setup() {
 
 void loop() {
 
+	if (hasFaulted()) {
+		return;
+	}
+
 	logln_info("[Motors] - Cycle %04ld - Start", cycle);
 
 	log_info("[Motors] - Cycle %04ld - Forward  - Accelerate for %is", cycle, ACCLERATION_DURATION_MS/1000);
 	accelerate(moveForward, ACCLERATION_DURATION_MS, ACCLERATION_STEP_MS);
+	if (hasFaulted()) return;
 
 	log_info("[Motors] - Cycle %04ld - Forward  - Move for %is", cycle, MOVEMENT_DURATION_MS/1000);
 	waitFor(MOVEMENT_DURATION_MS);
+	if (hasFaulted()) return;
 
 	log_info("[Motors] - Cycle %04ld - Forward  - Stop for %is", cycle, MOVEMENT_DURATION_MS/1000);
 	stop();
 	waitFor(MOVEMENT_DURATION_MS);
+	if (hasFaulted()) return;
 
 	log_info("[Motors] - Cycle %04ld - Backward - Accelerate for %is", cycle, ACCLERATION_DURATION_MS/1000);
 	accelerate(moveBackward, ACCLERATION_DURATION_MS, ACCLERATION_STEP_MS);
+	if (hasFaulted()) return;
 
 	log_info("[Motors] - Cycle %04ld - Backward - Move for %is", cycle, MOVEMENT_DURATION_MS/1000);
 	waitFor(MOVEMENT_DURATION_MS);
+	if (hasFaulted()) return;
 
 	log_info("[Motors] - Cycle %04ld - Backward - Stop for %is", cycle, MOVEMENT_DURATION_MS/1000);
 	stop();
 	waitFor(MOVEMENT_DURATION_MS);
+	if (hasFaulted()) return;
 
 	logln_info("[Motors] - Cycle %04ld - End\n", cycle);
 
+	cycleLog.commit(cycle, (uint8_t) Fault::none);
 	cycle++;
 
 }
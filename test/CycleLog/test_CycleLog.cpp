@@ -0,0 +1,83 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <Arduino.h>
+#include "CycleLog.h"
+#include "EepromModel.h"
+#include "Test.h"
+
+TEST(commitIsRestored) {
+	EepromModel eeprom = EepromModel(64);
+	CycleLog log = CycleLog(eeprom, 0, 64);
+
+	CHECK(!log.restore());
+	CHECK(log.isEmpty());
+
+	for (uint32_t cycle = 1; cycle <= 20; ++cycle) {
+		log.commit(cycle, (uint8_t) cycle);
+	}
+
+	CycleLog reloaded = CycleLog(eeprom, 0, 64);
+	CycleRecord record;
+
+	CHECK(reloaded.restore());
+	CHECK_EQUAL(20u, reloaded.cycle());
+	CHECK_EQUAL(20, reloaded.result());
+	CHECK(reloaded.read(7, record));
+	CHECK_EQUAL(13u, record.cycle);
+	CHECK(!reloaded.read(8, record));
+}
+
+TEST(logShorterThanSlotHasNoSlot) {
+	EepromModel eeprom = EepromModel(64);
+	CycleLog log = CycleLog(eeprom, 0, CycleLog::SLOT_SIZE - 1);
+	CycleRecord record;
+
+	CHECK_EQUAL(0, log.capacity());
+	CHECK(!log.restore());
+
+	log.commit(1, 0);
+
+	CHECK_EQUAL(0u, eeprom.writes());
+	CHECK(log.isEmpty());
+	CHECK(!log.read(0, record));
+}
+
+TEST(logIsClampedToEndOfEeprom) {
+	EepromModel eeprom = EepromModel(64);
+	CycleLog log = CycleLog(eeprom, 40, 64);
+	CycleLog outside = CycleLog(eeprom, 64, 64);
+
+	CHECK_EQUAL(3, log.capacity());
+	CHECK_EQUAL(0, outside.capacity());
+
+	for (uint32_t cycle = 1; cycle <= 4; ++cycle) {
+		log.commit(cycle, 0);
+	}
+
+	unsigned long writes = eeprom.writes();
+	outside.commit(1, 0);
+	CHECK_EQUAL(writes, eeprom.writes());
+
+	// The fourth commit wraps onto the first slot of the log, not onto address 0
+	for (uint16_t address = 0; address < 40; ++address) {
+		CHECK_EQUAL(0u, eeprom.wear(address));
+	}
+	CHECK_EQUAL(2u, eeprom.wear(40));
+}
@@ -0,0 +1,218 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+/**
+ * @file test_LekaLogger.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * This file is compiled once per flag combination by test/Makefile,
+ * with DEBUG_IS_ON, outputLevel and the show* flags set on the command line.
+ */
+
+#include <Arduino.h>
+#include "LekaLogger.h"
+#include "Test.h"
+
+#if defined(DEBUG_IS_ON)
+
+// Expected prefix of a message, '#' stands for any integer
+static std::string expectedPrefix(const char *level, int line, const char *function) {
+	std::string prefix;
+
+	if (showTime && showHumanReadableTime) {
+		prefix += "0001:02:03:004 ";
+	}
+	else if (showTime) {
+		prefix += "3723004 ";
+	}
+
+	if (showLevel) {
+		prefix += std::string("[") + level + "] ";
+	}
+
+	if (showFreeMemory) {
+		prefix += "# ";
+	}
+
+	if (showFileName) {
+		prefix += "[test_LekaLogger.cpp:" + std::to_string(line) + "] ";
+		if (showFunctionName) {
+			prefix += std::string(function) + " ";
+		}
+	}
+
+	if (showTime || showLevel || showFreeMemory || showFileName || showFunctionName) {
+		prefix += "> ";
+	}
+
+	return prefix;
+}
+
+static bool matches(const std::string &pattern, const std::string &output) {
+	size_t position = 0;
+
+	for (char c : pattern) {
+		if (c == '#') {
+			size_t start = position;
+			if (position < output.size() && output[position] == '-') {
+				position++;
+			}
+			while (position < output.size() && isdigit((unsigned char) output[position])) {
+				position++;
+			}
+			if (position == start) {
+				return false;
+			}
+		}
+		else if (position >= output.size() || output[position++] != c) {
+			return false;
+		}
+	}
+
+	return position == output.size();
+}
+
+#define CHECK_MATCH(pattern, output) do {                                  \
+	if (!matches(pattern, output)) {                                       \
+		Test::fail(__FILE__, __LINE__, "CHECK_MATCH(" #pattern ", " #output ")" \
+				"\n    expected: " + Test::describe(pattern) +             \
+				"\n    actual:   " + Test::describe(output));              \
+	}                                                                      \
+} while(0)
+
+static void start(void) {
+	ArduinoHost::reset();
+	ArduinoHost::setTime(3723004000UL);
+	Serial.capture(true);
+	Serial.clearOutput();
+}
+
+TEST(logInfoPrefixAndMessage) {
+	start();
+
+	log_info("[Motors] - Cycle %04ld - Start", 42L); int line = __LINE__;
+
+	if (outputLevel <= DebugLevel::info) {
+		CHECK_MATCH(expectedPrefix("INFO", line, __PRETTY_FUNCTION__) + "[Motors] - Cycle 0042 - Start", Serial.output());
+	}
+	else {
+		CHECK_EQUAL(std::string(""), Serial.output());
+	}
+}
+
+TEST(loglnErrorEndsWithNewLine) {
+	start();
+
+	logln_error("Fault: %s", "stall"); int line = __LINE__;
+
+	CHECK_MATCH(expectedPrefix("ERROR", line, __PRETTY_FUNCTION__) + "Fault: stall\r\n", Serial.output());
+}
+
+TEST(logWithoutArguments) {
+	start();
+
+	log_warning("Starting"); int line = __LINE__;
+
+	if (outputLevel <= DebugLevel::warning) {
+		CHECK_MATCH(expectedPrefix("WARNING", line, __PRETTY_FUNCTION__) + "Starting", Serial.output());
+	}
+}
+
+TEST(levelsBelowOutputLevelAreFiltered) {
+	start();
+
+	log_verbose("verbose");
+	log_debug("debug");
+
+	std::string expected;
+	if (outputLevel <= DebugLevel::verbose) {
+		expected += "verbose";
+	}
+	if (outputLevel <= DebugLevel::debug) {
+		expected += "debug";
+	}
+
+	CHECK_EQUAL(expected.size() != 0, Serial.output().size() != 0);
+	CHECK_EQUAL(outputLevel <= DebugLevel::debug, Serial.output().find("debug") != std::string::npos);
+	CHECK_EQUAL(outputLevel <= DebugLevel::verbose, Serial.output().find("verbose") != std::string::npos);
+}
+
+TEST(appendHasNoPrefix) {
+	start();
+
+	log_append(".");
+	log_append("%d%%", 50);
+	logln_append("");
+
+	CHECK_EQUAL(std::string(".50%\r\n"), Serial.output());
+}
+
+TEST(longMessageIsTruncatedToBuffer) {
+	start();
+
+	std::string message(3 * LOG_BUFFER_SIZE, 'x');
+	log_append("%s", message.c_str());
+
+	CHECK_EQUAL(std::string(LOG_BUFFER_SIZE - 1, 'x'), Serial.output());
+}
+
+TEST(messageOfBufferSizeIsTruncatedByOne) {
+	start();
+
+	std::string message(LOG_BUFFER_SIZE, 'y');
+	logln_append("%s", message.c_str());
+
+	CHECK_EQUAL(std::string(LOG_BUFFER_SIZE - 1, 'y') + "\r\n", Serial.output());
+}
+
+TEST(messageFillingBufferIsKept) {
+	start();
+
+	std::string message(LOG_BUFFER_SIZE - 1, 'z');
+	log_append("%s", message.c_str());
+
+	CHECK_EQUAL(message, Serial.output());
+}
+
+TEST(humanReadableTimeRollsOverHours) {
+	start();
+	ArduinoHost::setTime(36000000000UL + 59 * 60000000UL + 59999000UL);
+
+	LekaLogger::printHumanReadableTime();
+
+	CHECK_EQUAL(std::string("0010:59:59:999 "), Serial.output());
+}
+
+#else // DEBUG_IS_OFF
+
+TEST(nothingIsPrintedWhenDebugIsOff) {
+	Serial.capture(true);
+	Serial.clearOutput();
+
+	log_verbose("verbose %d", 1);
+	log_info("info");
+	logln_error("error %s", "stall");
+	log_append(".");
+	logln_append("");
+
+	CHECK_EQUAL(std::string(""), Serial.output());
+}
+
+#endif // DEBUG_IS_ON or DEBUG_IS_OFF
@@ -0,0 +1,116 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <vector>
+
+#include <Arduino.h>
+#include "IMotor.h"
+#include "Motor.h"
+#include "Test.h"
+
+struct PinEvent {
+	ArduinoHost::PinWrite kind;
+	uint8_t pin;
+	int value;
+
+	bool operator==(const PinEvent &other) const {
+		return kind == other.kind && pin == other.pin && value == other.value;
+	}
+};
+
+static std::vector<PinEvent> events;
+
+static void onPinWrite(ArduinoHost::PinWrite kind, uint8_t pin, int value, void *) {
+	events.push_back({ kind, pin, value });
+}
+
+static void start(void) {
+	ArduinoHost::reset();
+	ArduinoHost::setPinWriteHook(onPinWrite);
+	events.clear();
+}
+
+TEST(spinWritesDirectionThenSpeed) {
+	start();
+	Motor motor = Motor(4, 5);
+
+	motor.spin(Rotation::counterClockwise, 120);
+
+	CHECK_EQUAL(2u, events.size());
+	CHECK((events[0] == PinEvent { ArduinoHost::PinWrite::digital, 4, 1 }));
+	CHECK((events[1] == PinEvent { ArduinoHost::PinWrite::analog, 5, 120 }));
+}
+
+TEST(spinDefaultsToClockwiseAtMaxSpeed) {
+	start();
+	Motor motor = Motor(7, 6);
+
+	motor.spin();
+
+	CHECK_EQUAL(0, ArduinoHost::digitalValue(7));
+	CHECK_EQUAL(Motor::MAX_SPEED, ArduinoHost::analogValue(6));
+}
+
+TEST(stopSpinsClockwiseAtZeroSpeed) {
+	start();
+	Motor motor = Motor(4, 5);
+
+	motor.spin(Rotation::counterClockwise, 200);
+	events.clear();
+	motor.stop();
+
+	CHECK_EQUAL(2u, events.size());
+	CHECK((events[0] == PinEvent { ArduinoHost::PinWrite::digital, 4, 0 }));
+	CHECK((events[1] == PinEvent { ArduinoHost::PinWrite::analog, 5, 0 }));
+}
+
+TEST(commandSequenceThroughInterface) {
+	start();
+	Motor left = Motor(4, 5);
+	Motor right = Motor(7, 6);
+	IMotor *motors[] = { &left, &right };
+
+	motors[0]->spin(Rotation::clockwise, 10);
+	motors[1]->spin(Rotation::counterClockwise, 20);
+	motors[0]->stop();
+	motors[1]->spin(Rotation::clockwise, 255);
+
+	std::vector<PinEvent> expected = {
+		{ ArduinoHost::PinWrite::digital, 4, 0 }, { ArduinoHost::PinWrite::analog, 5, 10 },
+		{ ArduinoHost::PinWrite::digital, 7, 1 }, { ArduinoHost::PinWrite::analog, 6, 20 },
+		{ ArduinoHost::PinWrite::digital, 4, 0 }, { ArduinoHost::PinWrite::analog, 5, 0 },
+		{ ArduinoHost::PinWrite::digital, 7, 0 }, { ArduinoHost::PinWrite::analog, 6, 255 },
+	};
+
+	CHECK(events == expected);
+}
+
+TEST(motorsDoNotShareState) {
+	start();
+	Motor left = Motor(4, 5);
+	Motor right = Motor(7, 6);
+
+	left.spin(Rotation::counterClockwise, 50);
+	right.stop();
+
+	CHECK_EQUAL(1, ArduinoHost::digitalValue(4));
+	CHECK_EQUAL(50, ArduinoHost::analogValue(5));
+	CHECK_EQUAL(0, ArduinoHost::digitalValue(7));
+	CHECK_EQUAL(0, ArduinoHost::analogValue(6));
+}
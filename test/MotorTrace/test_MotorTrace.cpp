@@ -0,0 +1,416 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <vector>
+
+#include <Arduino.h>
+#include "Motor.h"
+#include "MotorTrace.h"
+#include "Test.h"
+
+class Capture : public Print {
+	public:
+		size_t write(uint8_t byte) {
+			bytes.push_back(byte);
+			return 1;
+		}
+
+		using Print::write;
+
+		std::vector<uint8_t> bytes;
+};
+
+static std::vector<MotorCommand> commands;
+
+static void onCommand(const MotorCommand &command, void *) {
+	commands.push_back(command);
+}
+
+static void decode(MotorTraceDecoder &decoder, const std::vector<uint8_t> &bytes) {
+	for (uint8_t byte : bytes) {
+		decoder.decode(byte);
+	}
+}
+
+// Builds a frame around a payload, with a valid checksum
+static std::vector<uint8_t> frame(uint32_t time, const std::vector<uint8_t> &payload) {
+	std::vector<uint8_t> bytes = {
+		MotorTrace::FRAME_SYNC,
+		(uint8_t) payload.size(),
+		0,
+		(uint8_t) time, (uint8_t) (time >> 8), (uint8_t) (time >> 16), (uint8_t) (time >> 24)
+	};
+	bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+	uint8_t sum = 0;
+	for (size_t i = 1; i < bytes.size(); ++i) {
+		sum += bytes[i];
+	}
+	bytes.push_back(sum);
+
+	return bytes;
+}
+
+static void start(void) {
+	ArduinoHost::reset();
+	commands.clear();
+}
+
+TEST(recordIsThreeBytesForShortDelta) {
+	start();
+	MotorTrace trace;
+	trace.begin();
+
+	delay(100);
+	CHECK(trace.record(1, Rotation::counterClockwise, 229));
+
+	CHECK_EQUAL(3, trace.available());
+}
+
+TEST(roundTripKeepsCommandsAndTiming) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	delay(5);
+	trace.record(0, Rotation::clockwise, 10);
+	delay(200);
+	trace.record(1, Rotation::counterClockwise, 20);
+	delay(70000);
+	trace.record(127, Rotation::clockwise, 255);
+	trace.flush(output);
+
+	CHECK_EQUAL(0, trace.available());
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(3u, commands.size());
+	CHECK_EQUAL(0u, decoder.errors());
+	CHECK_EQUAL(5u, commands[0].time);
+	CHECK_EQUAL(0, commands[0].motor);
+	CHECK_EQUAL(20, commands[1].speed);
+	CHECK_EQUAL(205u, commands[1].time);
+	CHECK((commands[1].rotation == Rotation::counterClockwise));
+	CHECK_EQUAL(70205u, commands[2].time);
+	CHECK_EQUAL(127, commands[2].motor);
+	CHECK_EQUAL(255, commands[2].speed);
+}
+
+// trace.available() at each write of the speed pin of the traced motor
+static std::vector<uint16_t> tracedAtSpeedWrite;
+
+static void onSpeedWrite(ArduinoHost::PinWrite kind, uint8_t pin, int, void *context) {
+	if (kind == ArduinoHost::PinWrite::analog && pin == 5) {
+		tracedAtSpeedWrite.push_back(((MotorTrace *) context)->available());
+	}
+}
+
+TEST(tracedMotorTracesSpinBeforeAndStopAfterForwarding) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	Motor motor = Motor(4, 5);
+	TracedMotor traced = TracedMotor(motor, 3, trace);
+	trace.begin();
+
+	tracedAtSpeedWrite.clear();
+	ArduinoHost::setPinWriteHook(onSpeedWrite, &trace);
+
+	traced.spin(Rotation::counterClockwise, 42);
+	traced.stop();
+
+	ArduinoHost::setPinWriteHook(nullptr);
+
+	// The spin is traced before the pins change, the stop after
+	CHECK_EQUAL(2u, tracedAtSpeedWrite.size());
+	CHECK(tracedAtSpeedWrite.size() == 2 && tracedAtSpeedWrite[0] == 3);
+	CHECK(tracedAtSpeedWrite.size() == 2 && tracedAtSpeedWrite[1] == 3);
+	CHECK_EQUAL(6, trace.available());
+
+	trace.flush(output);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(2u, commands.size());
+	CHECK_EQUAL(3, commands[0].motor);
+	CHECK_EQUAL(42, commands[0].speed);
+	CHECK_EQUAL(0, commands[1].speed);
+	CHECK_EQUAL(0, ArduinoHost::analogValue(5));
+}
+
+TEST(fullRingDropsAndKeepsTimingOfNextCommand) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	unsigned long recorded = 0;
+	for (int i = 0; i < 100; ++i) {
+		delay(1);
+		recorded += trace.record(0, Rotation::clockwise, i);
+	}
+
+	CHECK(recorded < 100);
+	CHECK(trace.available() <= MotorTrace::BUFFER_SIZE);
+	CHECK(MotorTrace::BUFFER_SIZE - trace.available() < MotorTrace::MAX_RECORD_SIZE);
+	CHECK_EQUAL(100 - recorded, trace.dropped());
+
+	trace.flush(output);
+	delay(1);
+	trace.record(1, Rotation::clockwise, 7);
+	trace.flush(output);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(recorded + 1, commands.size());
+	CHECK_EQUAL(100 - recorded, decoder.dropped());
+	CHECK_EQUAL(101u, commands.back().time);
+}
+
+TEST(dropsAboveFrameFieldAreReportedInNextFrames) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	while (trace.record(0, Rotation::clockwise, 1)) {
+	}
+	for (int i = 0; i < 299; ++i) {
+		trace.record(0, Rotation::clockwise, 1);
+	}
+
+	CHECK_EQUAL(300, trace.dropped());
+
+	trace.flush(output);
+	CHECK_EQUAL(45, trace.dropped());
+	trace.flush(output);
+	CHECK_EQUAL(0, trace.dropped());
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(0u, decoder.errors());
+	CHECK_EQUAL(300u, decoder.dropped());
+}
+
+TEST(largestDeltaFitsInRecord) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	ArduinoHost::setTime(0xFFFFFFFFUL / 1000 * 1000);
+	CHECK(trace.record(0, Rotation::clockwise, 1));
+	CHECK(trace.available() <= MotorTrace::MAX_RECORD_SIZE);
+	trace.flush(output);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(1u, commands.size());
+	CHECK_EQUAL(0xFFFFFFFFUL / 1000, commands[0].time);
+}
+
+TEST(emptyFlushWritesNothing) {
+	start();
+	MotorTrace trace;
+	Capture output;
+
+	trace.flush(output);
+
+	CHECK_EQUAL(0u, output.bytes.size());
+}
+
+TEST(decoderSkipsCorruptedFrameAndResyncs) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	std::vector<std::vector<uint8_t>> frames;
+	for (int i = 1; i <= 3; ++i) {
+		delay(1000);
+		trace.record(0, Rotation::clockwise, i);
+		trace.flush(output);
+		frames.push_back(output.bytes);
+		output.bytes.clear();
+	}
+
+	// Flip one bit of the payload of the second frame
+	frames[1][1 + MotorTrace::FRAME_HEADER_SIZE] ^= 0x01;
+
+	std::vector<uint8_t> stream = { 0x00, 0x42 };
+	for (auto &bytes : frames) {
+		stream.insert(stream.end(), bytes.begin(), bytes.end());
+	}
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(2u, commands.size());
+	CHECK_EQUAL(1, commands[0].speed);
+	CHECK_EQUAL(1000u, commands[0].time);
+	CHECK_EQUAL(3, commands[1].speed);
+	CHECK_EQUAL(3000u, commands[1].time);
+}
+
+TEST(decoderKeepsTimeAfterLostFrame) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	delay(1000);
+	trace.record(0, Rotation::clockwise, 1);
+	trace.flush(output);
+	output.bytes.clear();
+
+	delay(1000);
+	trace.record(0, Rotation::clockwise, 2);
+	delay(500);
+	trace.record(0, Rotation::clockwise, 3);
+	trace.flush(output);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(0u, decoder.errors());
+	CHECK_EQUAL(2u, commands.size());
+	CHECK_EQUAL(2000u, commands[0].time);
+	CHECK_EQUAL(2500u, commands[1].time);
+}
+
+TEST(decoderRescansAfterCorruptedLength) {
+	start();
+
+	std::vector<uint8_t> good = frame(1234, { 0x05, 0x02, 0x07 });
+
+	// A length of 20 makes the first frame swallow the SYNC of the second one
+	std::vector<uint8_t> stream = frame(1000, { 0x05, 0x02, 0x01 });
+	stream[1] = 20;
+	stream.insert(stream.end(), good.begin(), good.end());
+	stream.insert(stream.end(), 20, 0x00);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(1u, commands.size());
+	CHECK_EQUAL(7, commands[0].speed);
+	CHECK_EQUAL(1234u, commands[0].time);
+}
+
+TEST(finishRescansTrailingFakeFrame) {
+	start();
+	MotorTrace trace;
+	Capture output;
+	trace.begin();
+
+	// A speed equal to SYNC followed by a 120ms delta looks like a frame of 120 bytes
+	delay(10);
+	trace.record(0, Rotation::clockwise, MotorTrace::FRAME_SYNC);
+	delay(120);
+	trace.record(0, Rotation::clockwise, 1);
+	trace.flush(output);
+	output.bytes[0] = 0x00;
+
+	for (int i = 1; i <= 3; ++i) {
+		delay(1000);
+		trace.record(0, Rotation::clockwise, 10 + i);
+		trace.flush(output);
+	}
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, output.bytes);
+
+	CHECK_EQUAL(0u, commands.size());
+
+	decoder.finish();
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(3u, commands.size());
+	CHECK_EQUAL(11, commands[0].speed);
+	CHECK_EQUAL(1130u, commands[0].time);
+	CHECK_EQUAL(13, commands[2].speed);
+	CHECK_EQUAL(3130u, commands[2].time);
+}
+
+TEST(finishCountsFrameCutByEndOfStream) {
+	start();
+
+	std::vector<uint8_t> stream = frame(0, { 0x00, 0x02, 0x07 });
+	stream.pop_back();
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+	decoder.finish();
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(0u, commands.size());
+}
+
+TEST(decoderRejectsTruncatedRecord) {
+	start();
+
+	// Valid checksum, but the record is missing its speed byte
+	std::vector<uint8_t> stream = frame(0, { 0x05, 0x02 });
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(0u, commands.size());
+}
+
+TEST(decoderRejectsOverlongDelta) {
+	start();
+
+	std::vector<uint8_t> stream = frame(0, { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01, 0x00, 0x00 });
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+
+	CHECK_EQUAL(1u, decoder.errors());
+	CHECK_EQUAL(0u, commands.size());
+}
+
+TEST(decoderAcceptsLongestFrame) {
+	start();
+
+	std::vector<uint8_t> payload;
+	for (int i = 0; i < 85; ++i) {
+		payload.push_back(0x01);
+		payload.push_back(0x00);
+		payload.push_back((uint8_t) i);
+	}
+	std::vector<uint8_t> stream = frame(100, payload);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	decode(decoder, stream);
+
+	CHECK_EQUAL(0u, decoder.errors());
+	CHECK_EQUAL(85u, commands.size());
+	CHECK_EQUAL(100u, commands.front().time);
+	CHECK_EQUAL(184u, commands.back().time);
+}
@@ -0,0 +1,324 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+/**
+ * @file test_main.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Runs the Motors firmware on the host: ramp and wait timing, safety
+ * supervisor reaction and cycle persistence.
+ */
+
+#include "../../src/Motors/main.cpp"
+
+#include <new>
+#include <vector>
+
+#include "Test.h"
+
+struct PinEvent {
+	unsigned long time;
+	ArduinoHost::PinWrite kind;
+	uint8_t pin;
+	int value;
+	uint16_t traced;
+};
+
+static std::vector<PinEvent> events;
+
+static void onPinWrite(ArduinoHost::PinWrite kind, uint8_t pin, int value, void *) {
+	events.push_back({ micros(), kind, pin, value, motorTrace.available() });
+}
+
+static std::vector<PinEvent> analogWrites(uint8_t pin) {
+	std::vector<PinEvent> writes;
+	for (auto &event : events) {
+		if (event.kind == ArduinoHost::PinWrite::analog && event.pin == pin) {
+			writes.push_back(event);
+		}
+	}
+	return writes;
+}
+
+static void start(void) {
+	ArduinoHost::setPinWriteHook(onPinWrite);
+	events.clear();
+	Serial.capture(true);
+	Serial.clearOutput();
+}
+
+// Simulates a reset of the board, the EEPROM is kept
+static void boot(void) {
+	ArduinoHost::reset();
+
+	new (&safety) SafetySupervisor();
+	new (&motorTrace) MotorTrace();
+	faultReported = false;
+	cycle = 1;
+
+	start();
+	setup();
+	start();
+}
+
+//
+// Mark:- Ramp & wait
+//
+
+TEST(accelerateRampsSpeedInEqualSteps) {
+	ArduinoHost::reset();
+	start();
+
+	unsigned long begin = micros();
+	accelerate(moveForward, ACCLERATION_DURATION_MS, ACCLERATION_STEP_MS);
+	unsigned long elapsed = micros() - begin;
+
+	auto right = analogWrites(MOTOR_RIGHT_SPEED_PIN);
+	auto left = analogWrites(MOTOR_LEFT_SPEED_PIN);
+
+	CHECK_EQUAL(21u, right.size());
+	CHECK_EQUAL(21u, left.size());
+
+	for (size_t i = 0; i < 20 && i < right.size(); ++i) {
+		CHECK_EQUAL((int) (MOTOR_MAX_SPEED / 20 * i), right[i].value);
+		CHECK_EQUAL(right[i].value, left[i].value);
+		CHECK(right[i].time - begin >= i * ACCLERATION_STEP_MS * 1000);
+		CHECK(right[i].time - begin < i * ACCLERATION_STEP_MS * 1000 + 1000);
+	}
+
+	CHECK_EQUAL(MOTOR_MAX_SPEED, right.back().value);
+	CHECK_EQUAL(0, ArduinoHost::digitalValue(MOTOR_RIGHT_DIRECTION_PIN));
+	CHECK_EQUAL(1, ArduinoHost::digitalValue(MOTOR_LEFT_DIRECTION_PIN));
+
+	CHECK(elapsed >= ACCLERATION_DURATION_MS * 1000UL);
+	CHECK(elapsed < ACCLERATION_DURATION_MS * 1000UL + 1000);
+	CHECK_EQUAL(std::string(20, '.') + "\r\n", Serial.output());
+}
+
+TEST(accelerateWaitsForRemainingTime) {
+	ArduinoHost::reset();
+	start();
+
+	unsigned long begin = millis();
+	accelerate(moveBackward, 250, 100, 100);
+
+	auto right = analogWrites(MOTOR_RIGHT_SPEED_PIN);
+
+	CHECK_EQUAL(3u, right.size());
+	CHECK_EQUAL(0, right[0].value);
+	CHECK_EQUAL(50, right[1].value);
+	CHECK_EQUAL(100, right[2].value);
+	CHECK_EQUAL(1, ArduinoHost::digitalValue(MOTOR_RIGHT_DIRECTION_PIN));
+	CHECK_EQUAL(0, ArduinoHost::digitalValue(MOTOR_LEFT_DIRECTION_PIN));
+	CHECK_EQUAL(250u, millis() - begin);
+	CHECK_EQUAL(std::string("...\r\n"), Serial.output());
+}
+
+TEST(accelerateBatchesTraceFrames) {
+	boot();
+	TRACE_SERIAL.capture(true);
+	TRACE_SERIAL.clearOutput();
+
+	accelerate(moveForward, ACCLERATION_DURATION_MS, ACCLERATION_STEP_MS);
+	motorTrace.flush(TRACE_SERIAL);
+
+	MotorTraceDecoder decoder = MotorTraceDecoder([](const MotorCommand &, void *) {});
+	for (char byte : TRACE_SERIAL.output()) {
+		decoder.decode((uint8_t) byte);
+	}
+	decoder.finish();
+
+	CHECK_EQUAL(0u, decoder.errors());
+	CHECK_EQUAL(42u, decoder.commands());
+
+	// 42 records of 3 bytes, the first one may take 2 more for the delay since setup(),
+	// sent in 2 frames instead of one per step
+	CHECK(TRACE_SERIAL.output().size() <= 42 * 3 + 2 + 2 * (MotorTrace::FRAME_HEADER_SIZE + 2));
+
+	TRACE_SERIAL.capture(false);
+	TRACE_SERIAL.clearOutput();
+}
+
+TEST(waitForKeepsMotorsAndDuration) {
+	ArduinoHost::reset();
+	start();
+
+	unsigned long begin = millis();
+	waitFor(MOVEMENT_DURATION_MS);
+
+	CHECK_EQUAL(0u, events.size());
+	CHECK_EQUAL((unsigned long) MOVEMENT_DURATION_MS, millis() - begin);
+	CHECK_EQUAL(std::string(60, '.') + "\r\n", Serial.output());
+}
+
+TEST(waitForWaitsForRemainingTime) {
+	ArduinoHost::reset();
+	start();
+
+	unsigned long begin = millis();
+	waitFor(1250);
+
+	CHECK_EQUAL(1250u, millis() - begin);
+	CHECK_EQUAL(std::string("...\r\n"), Serial.output());
+}
+
+//
+// Mark:- Cycle
+//
+
+TEST(cycleIsCommittedAndResumedAfterReset) {
+	ArduinoHost::eraseEeprom();
+	boot();
+
+	unsigned long begin = millis();
+	loop();
+	unsigned long elapsed = millis() - begin;
+
+	// Pin writes outside of delay() add a few microseconds per step
+	CHECK(elapsed >= 2ul * ACCLERATION_DURATION_MS + 4ul * MOVEMENT_DURATION_MS);
+	CHECK(elapsed <= 2ul * ACCLERATION_DURATION_MS + 4ul * MOVEMENT_DURATION_MS + 5);
+	CHECK(!safety.hasFaulted());
+	CHECK_EQUAL(2ul, cycle);
+	CHECK_EQUAL(0, ArduinoHost::analogValue(MOTOR_LEFT_SPEED_PIN));
+	CHECK_EQUAL(0, ArduinoHost::analogValue(MOTOR_RIGHT_SPEED_PIN));
+
+	boot();
+
+	CHECK_EQUAL(2ul, cycle);
+	CHECK_EQUAL(1u, cycleLog.cycle());
+	CHECK_EQUAL((uint8_t) Fault::none, cycleLog.result());
+}
+
+//
+// Mark:- Safety
+//
+
+TEST(overcurrentStopsMotorsWithinOneCheck) {
+	boot();
+
+	moveForward(MOTOR_MAX_SPEED);
+	unsigned long injected = micros();
+	ArduinoHost::setAnalogInput(MOTOR_LEFT_CURRENT_PIN, SAFETY_OVERCURRENT);
+	events.clear();
+
+	waitFor(MOVEMENT_DURATION_MS);
+
+	auto left = analogWrites(MOTOR_LEFT_SPEED_PIN);
+	auto right = analogWrites(MOTOR_RIGHT_SPEED_PIN);
+
+	CHECK(hasFaulted());
+	CHECK_EQUAL((uint8_t) Fault::overcurrent, (uint8_t) safety.fault());
+	CHECK_EQUAL(0, safety.faultedMotor());
+	CHECK_EQUAL(1u, right.size());
+	CHECK_EQUAL(0, ArduinoHost::analogValue(MOTOR_LEFT_SPEED_PIN));
+	CHECK_EQUAL(0, ArduinoHost::analogValue(MOTOR_RIGHT_SPEED_PIN));
+	CHECK(right.size() == 1 && right[0].time - injected <= SafetySupervisor::CHECK_PERIOD_MS * 1000UL + safety.reactionTime());
+
+	// Each motor is stopped before its stop command is traced, the host does
+	// not charge time for tracing so this checks the order instead
+	CHECK(left.size() == 1 && left[0].traced == 0);
+	CHECK(right.size() == 1 && right[0].traced == 3);
+
+	// One current read, then both motors stopped
+	unsigned long expectedReaction = ArduinoHost::ANALOG_READ_US + 2 * (ArduinoHost::DIGITAL_WRITE_US + ArduinoHost::ANALOG_WRITE_US);
+	CHECK_EQUAL(expectedReaction, safety.reactionTime());
+
+	CHECK(millis() - injected / 1000 < 1000);
+	CHECK(Serial.output().find("Fault: overcurrent - Motor: 0 - Motors stopped in " + std::to_string(expectedReaction) + "us") != std::string::npos);
+
+	moveBackward(MOTOR_MAX_SPEED);
+	CHECK_EQUAL(0, ArduinoHost::analogValue(MOTOR_RIGHT_SPEED_PIN));
+
+	CycleLog reloaded = CycleLog(eeprom, CYCLE_LOG_START, CYCLE_LOG_LENGTH);
+	CHECK(reloaded.restore());
+	CHECK_EQUAL((uint8_t) Fault::overcurrent, reloaded.result());
+}
+
+TEST(stallTripsAfterStallTicks) {
+	boot();
+
+	moveForward(MOTOR_MAX_SPEED);
+	unsigned long injected = micros();
+	ArduinoHost::setAnalogInput(MOTOR_RIGHT_CURRENT_PIN, SAFETY_STALL_CURRENT);
+	events.clear();
+
+	waitFor(MOVEMENT_DURATION_MS);
+
+	auto right = analogWrites(MOTOR_RIGHT_SPEED_PIN);
+
+	CHECK_EQUAL((uint8_t) Fault::stall, (uint8_t) safety.fault());
+	CHECK_EQUAL(1, safety.faultedMotor());
+	CHECK_EQUAL(1u, right.size());
+	CHECK(right.size() == 1 && right[0].time - injected >= (SAFETY_STALL_TICKS - 1) * SafetySupervisor::CHECK_PERIOD_MS * 1000UL);
+	CHECK(right.size() == 1 && right[0].time - injected <= (SAFETY_STALL_TICKS + 1) * SafetySupervisor::CHECK_PERIOD_MS * 1000UL);
+
+	// The current read of the left motor, checked first, is not part of the reaction
+	unsigned long expectedReaction = ArduinoHost::ANALOG_READ_US + 2 * (ArduinoHost::DIGITAL_WRITE_US + ArduinoHost::ANALOG_WRITE_US);
+	CHECK_EQUAL(expectedReaction, safety.reactionTime());
+}
+
+TEST(shortCurrentPeakDoesNotTripStall) {
+	boot();
+
+	moveForward(MOTOR_MAX_SPEED);
+	ArduinoHost::setAnalogInput(MOTOR_RIGHT_CURRENT_PIN, SAFETY_STALL_CURRENT);
+	safety.feed();
+	delay((SAFETY_STALL_TICKS / 2) * SafetySupervisor::CHECK_PERIOD_MS);
+	ArduinoHost::setAnalogInput(MOTOR_RIGHT_CURRENT_PIN, 0);
+	waitFor(2000);
+
+	CHECK(!safety.hasFaulted());
+	CHECK_EQUAL(MOTOR_MAX_SPEED, ArduinoHost::analogValue(MOTOR_RIGHT_SPEED_PIN));
+}
+
+TEST(missingFeedTripsCommandTimeout) {
+	boot();
+
+	moveForward(MOTOR_MAX_SPEED);
+	safety.feed();
+	unsigned long fed = micros();
+	events.clear();
+
+	delay(2 * SAFETY_COMMAND_TIMEOUT_MS);
+
+	auto right = analogWrites(MOTOR_RIGHT_SPEED_PIN);
+
+	CHECK_EQUAL((uint8_t) Fault::commandTimeout, (uint8_t) safety.fault());
+	CHECK_EQUAL(1u, right.size());
+	CHECK(right.size() == 1 && right[0].time - fed >= SAFETY_COMMAND_TIMEOUT_MS * 1000UL);
+	CHECK(right.size() == 1 && right[0].time - fed <= (SAFETY_COMMAND_TIMEOUT_MS + 2 * SafetySupervisor::CHECK_PERIOD_MS) * 1000UL);
+}
+
+TEST(blockedInterruptResetsTheBoard) {
+	boot();
+
+	uint8_t oldSREG = SREG;
+	cli();
+	delay(3 * SafetySupervisor::CHECK_PERIOD_MS);
+	SREG = oldSREG;
+
+	CHECK_EQUAL(1u, ArduinoHost::watchdogResets());
+	CHECK(MCUSR & _BV(WDRF));
+
+	// The startup code of the next run saves and clears the flags
+	new (&safety) SafetySupervisor();
+	CHECK(safety.wasWatchdogReset());
+	CHECK_EQUAL(0, MCUSR);
+}
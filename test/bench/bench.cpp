@@ -0,0 +1,339 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+/**
+ * @file bench.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Host benchmarks of the hot paths of the Motors firmware.
+ *
+ * Usage: bench [--baseline file] [--write file] [--tolerance ratio]
+ *
+ * Each result is divided by the time of a fixed reference workload measured
+ * in the same run, so the baseline does not depend much on the host speed.
+ * The run fails if a benchmark is more than tolerance (default 1.5) times
+ * slower than its baseline.
+ */
+
+#include "../../src/Motors/main.cpp"
+
+#include <chrono>
+#include <map>
+#include <new>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "EepromModel.h"
+
+class NullOutput : public Print {
+	public:
+		size_t write(uint8_t) {
+			return 1;
+		}
+
+		using Print::write;
+};
+
+struct Benchmark {
+	const char *name;
+	void (*setup)(void);
+	void (*run)(unsigned long iterations);
+};
+
+static volatile uint32_t sink;
+
+//
+// Mark:- Benchmarks
+//
+
+static void reference(unsigned long iterations) {
+	uint32_t x = 2463534242UL;
+	for (unsigned long i = 0; i < iterations; ++i) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+	}
+	sink = x;
+}
+
+static void noSetup(void) {
+}
+
+static void motorSpin(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		motorLeftDriver.spin(Rotation::clockwise, i & 0xFF);
+	}
+}
+
+static NullOutput nullOutput;
+
+static void tracedSpin(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		motorLeft.spin(Rotation::counterClockwise, i & 0xFF);
+		if ((i & 0x1F) == 0) {
+			motorTrace.flush(nullOutput);
+		}
+	}
+	motorTrace.flush(nullOutput);
+}
+
+static std::vector<uint8_t> traceStream;
+
+static void traceStreamSetup(void) {
+	class Capture : public Print {
+		public:
+			size_t write(uint8_t byte) {
+				traceStream.push_back(byte);
+				return 1;
+			}
+			using Print::write;
+	} capture;
+
+	traceStream.clear();
+	MotorTrace trace;
+	trace.begin();
+	for (int i = 0; i < 4000; ++i) {
+		delay(100);
+		trace.record(i & 1, (Rotation) (i & 1), i & 0xFF);
+		if ((i & 0x1F) == 0) {
+			trace.flush(capture);
+		}
+	}
+	trace.flush(capture);
+}
+
+static void onCommand(const MotorCommand &command, void *) {
+	sink = command.speed;
+}
+
+static void traceDecode(unsigned long iterations) {
+	MotorTraceDecoder decoder = MotorTraceDecoder(onCommand);
+	for (unsigned long i = 0; i < iterations; ++i) {
+		decoder.decode(traceStream[i % traceStream.size()]);
+	}
+}
+
+static EepromModel eepromModel = EepromModel(E2END + 1);
+static CycleLog modelLog = CycleLog(eepromModel, 0, E2END + 1);
+
+static void cycleLogSetup(void) {
+	modelLog.restore();
+	for (uint32_t i = 0; i < 3000; ++i) {
+		modelLog.commit(i, 0);
+	}
+}
+
+static void cycleLogCommit(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		modelLog.commit(i, i & 0x03);
+	}
+}
+
+static void cycleLogRestore(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		modelLog.restore();
+	}
+	sink = modelLog.cycle();
+}
+
+static void safetySetup(void) {
+	new (&safety) SafetySupervisor();
+	safety.attach(motorLeft, MOTOR_LEFT_CURRENT_PIN);
+	safety.attach(motorRight, MOTOR_RIGHT_CURRENT_PIN);
+	safety.setCurrentLimits(SAFETY_STALL_CURRENT, SAFETY_OVERCURRENT, SAFETY_STALL_TICKS);
+	safety.begin(SAFETY_COMMAND_TIMEOUT_MS);
+	// Only measure check(), not the simulated watchdog
+	wdt_disable();
+}
+
+static void safetyCheck(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		safety.feed();
+		safety.check();
+	}
+}
+
+static void logInfo(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		log_info("[Motors] - Cycle %04ld - Forward  - Move for %is", (long) i, MOVEMENT_DURATION_MS / 1000);
+		Serial.clearOutput();
+	}
+}
+
+static void accelerateRamp(unsigned long iterations) {
+	for (unsigned long i = 0; i < iterations; ++i) {
+		accelerate(moveForward, ACCLERATION_DURATION_MS, ACCLERATION_STEP_MS);
+		motorTrace.flush(nullOutput);
+		Serial.clearOutput();
+	}
+}
+
+static const Benchmark BENCHMARKS[] = {
+	{ "motor_spin",        noSetup,          motorSpin },
+	{ "traced_spin",       noSetup,          tracedSpin },
+	{ "trace_decode",      traceStreamSetup, traceDecode },
+	{ "cycle_log_commit",  cycleLogSetup,    cycleLogCommit },
+	{ "cycle_log_restore", cycleLogSetup,    cycleLogRestore },
+	{ "safety_check",      safetySetup,      safetyCheck },
+	{ "log_info",          noSetup,          logInfo },
+	{ "accelerate",        safetySetup,      accelerateRamp },
+};
+
+//
+// Mark:- Runner
+//
+
+static const double MIN_RUN_NS  = 20e6;
+static const int    REPETITIONS = 7;
+
+// Returns the best time per iteration in ns
+static double measure(void (*run)(unsigned long)) {
+	unsigned long iterations = 1;
+	double ns = 0;
+
+	for (;;) {
+		auto start = std::chrono::steady_clock::now();
+		run(iterations);
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if (ns >= MIN_RUN_NS) {
+			break;
+		}
+		iterations *= ns < MIN_RUN_NS / 100 ? 10 : 2;
+	}
+
+	double best = ns / iterations;
+
+	for (int i = 1; i < REPETITIONS; ++i) {
+		auto start = std::chrono::steady_clock::now();
+		run(iterations);
+		ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		if (ns / iterations < best) {
+			best = ns / iterations;
+		}
+	}
+
+	return best;
+}
+
+static std::map<std::string, double> readBaseline(const char *path) {
+	std::map<std::string, double> baseline;
+	FILE *file = fopen(path, "r");
+
+	if (file == nullptr) {
+		return baseline;
+	}
+
+	char line[128];
+	while (fgets(line, sizeof(line), file) != nullptr) {
+		char name[64];
+		double relative;
+		if (line[0] != '#' && sscanf(line, "%63s %lf", name, &relative) == 2) {
+			baseline[name] = relative;
+		}
+	}
+
+	fclose(file);
+	return baseline;
+}
+
+int main(int argc, char **argv) {
+	const char *baselinePath = nullptr;
+	const char *writePath = nullptr;
+	double tolerance = 1.5;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baselinePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+			writePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+			tolerance = strtod(argv[++i], nullptr);
+		}
+		else {
+			fprintf(stderr, "usage: bench [--baseline file] [--write file] [--tolerance ratio]\n");
+			return 2;
+		}
+	}
+
+	ArduinoHost::reset();
+	Serial.capture(true);
+
+	std::map<std::string, double> baseline;
+	if (baselinePath != nullptr) {
+		baseline = readBaseline(baselinePath);
+	}
+
+	double referenceNs = measure(reference);
+	std::map<std::string, double> results;
+	unsigned long regressions = 0;
+
+	printf("%-20s %12s %10s %10s %8s\n", "benchmark", "ns/op", "relative", "baseline", "change");
+	printf("%-20s %12.2f %10s\n", "reference", referenceNs, "1");
+
+	for (const Benchmark &benchmark : BENCHMARKS) {
+		benchmark.setup();
+
+		double ns = measure(benchmark.run);
+		double relative = ns / referenceNs;
+		results[benchmark.name] = relative;
+
+		auto entry = baseline.find(benchmark.name);
+
+		if (entry == baseline.end()) {
+			printf("%-20s %12.2f %10.2f %10s %8s\n", benchmark.name, ns, relative, "-", "new");
+			continue;
+		}
+
+		double change = relative / entry->second;
+		bool regressed = change > tolerance;
+		regressions += regressed;
+
+		printf("%-20s %12.2f %10.2f %10.2f %+7.0f%%%s\n",
+				benchmark.name,
+				ns,
+				relative,
+				entry->second,
+				(change - 1) * 100,
+				regressed ? "  REGRESSION" : "");
+	}
+
+	if (writePath != nullptr) {
+		FILE *file = fopen(writePath, "w");
+		if (file == nullptr) {
+			fprintf(stderr, "bench: cannot write %s\n", writePath);
+			return 1;
+		}
+		fprintf(file, "# Time per operation relative to the reference workload, see test/bench/bench.cpp\n");
+		for (const Benchmark &benchmark : BENCHMARKS) {
+			fprintf(file, "%-20s %.3f\n", benchmark.name, results[benchmark.name]);
+		}
+		fclose(file);
+	}
+
+	if (regressions != 0) {
+		printf("%lu benchmark(s) more than %.2fx slower than baseline\n", regressions, tolerance);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Test.h"
+
+
+/**
+ * @file Test.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Usage: test_xxx [filter]
+ * Only runs the cases whose "suite.name" contains filter.
+ */
+
+namespace Test {
+
+	static Case *first = nullptr;
+	static Case *last = nullptr;
+
+	static unsigned long failures = 0;
+
+	Case::Case(const char *suite, const char *name, Function function) {
+		this->suite = suite;
+		this->name = name;
+		this->function = function;
+		this->next = nullptr;
+
+		if (last == nullptr) {
+			first = this;
+		}
+		else {
+			last->next = this;
+		}
+		last = this;
+	}
+
+	void fail(const char *file, int line, const std::string &message) {
+		failures++;
+		printf("    %s:%d: %s\n", file, line, message.c_str());
+	}
+
+	std::string describe(long long value) {
+		return std::to_string(value);
+	}
+
+	std::string describe(const std::string &value) {
+		std::string escaped = "\"";
+		for (char c : value) {
+			if (c == '\n') {
+				escaped += "\\n";
+			}
+			else if (c == '\r') {
+				escaped += "\\r";
+			}
+			else {
+				escaped += c;
+			}
+		}
+		return escaped + "\"";
+	}
+
+} // namespace Test
+
+int main(int argc, char **argv) {
+	const char *filter = argc > 1 ? argv[1] : "";
+
+	unsigned long cases = 0;
+	unsigned long failed = 0;
+
+	for (Test::Case *test = Test::first; test != nullptr; test = test->next) {
+		std::string name = std::string(test->suite) + "." + test->name;
+
+		if (strstr(name.c_str(), filter) == nullptr) {
+			continue;
+		}
+
+		unsigned long failuresBefore = Test::failures;
+		test->function();
+		cases++;
+
+		if (Test::failures != failuresBefore) {
+			failed++;
+			printf("[FAIL] %s\n", name.c_str());
+		}
+		else {
+			printf("[ OK ] %s\n", name.c_str());
+		}
+	}
+
+	printf("%lu case(s), %lu failed\n", cases, failed);
+
+	return failed == 0 ? 0 : 1;
+}
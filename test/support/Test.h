@@ -0,0 +1,80 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_TEST_H_
+#define LEKA_TEST_H_
+
+/**
+ * @file Test.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Minimal host test runner. Each TEST() registers itself at static
+ * initialization and Test.cpp provides main(), so a test binary is just
+ * a list of test files linked with the code under test.
+ */
+
+#include <string>
+
+#ifndef TEST_SUITE
+#define TEST_SUITE __FILE__
+#endif
+
+namespace Test {
+
+	typedef void (*Function)(void);
+
+	struct Case {
+		Case(const char *suite, const char *name, Function function);
+
+		const char *suite;
+		const char *name;
+		Function function;
+		Case *next;
+	};
+
+	void fail(const char *file, int line, const std::string &message);
+
+	std::string describe(long long value);
+	std::string describe(const std::string &value);
+
+} // namespace Test
+
+#define TEST(name)                                                     \
+	static void name(void);                                            \
+	static Test::Case name##_case = Test::Case(TEST_SUITE, #name, name); \
+	static void name(void)
+
+#define CHECK(condition) do {                                     \
+	if (!(condition)) {                                           \
+		Test::fail(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+	}                                                             \
+} while(0)
+
+#define CHECK_EQUAL(expected, actual) do {                                        \
+	auto _expected = (expected);                                                  \
+	auto _actual = (actual);                                                      \
+	if (!(_expected == _actual)) {                                                \
+		Test::fail(__FILE__, __LINE__, "CHECK_EQUAL(" #expected ", " #actual ")" \
+				"\n    expected: " + Test::describe(_expected) +                  \
+				"\n    actual:   " + Test::describe(_actual));                    \
+	}                                                                             \
+} while(0)
+
+#endif
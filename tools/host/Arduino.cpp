@@ -0,0 +1,343 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include "Arduino.h"
+
+
+/**
+ * @file Arduino.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+static const uint8_t PIN_COUNT = 70;
+
+static const unsigned long WATCHDOG_BASE_PERIOD_US = 16000;
+
+// Interrupts are enabled, as after init()
+uint8_t SREG = _BV(SREG_I);
+
+uint8_t WDTCSR = 0;
+uint8_t MCUSR = 0;
+
+HardwareSerial Serial  = HardwareSerial(stdout);
+HardwareSerial Serial1 = HardwareSerial(nullptr);
+
+// Defined by ISR(WDT_vect) if the program has one
+extern "C" void WDT_vect(void) __attribute__((weak));
+
+namespace ArduinoHost {
+
+	static unsigned long now = 0;
+
+	static int digitalValues[PIN_COUNT];
+	static int analogValues[PIN_COUNT];
+	static int analogInputs[PIN_COUNT];
+
+	static uint8_t eeprom[E2END + 1];
+
+	static unsigned long watchdogDeadline = 0;
+	static unsigned long resets = 0;
+
+	static PinWriteHook pinWriteHook = nullptr;
+	static void *pinWriteContext = nullptr;
+
+	void reset(void) {
+		now = 0;
+		memset(digitalValues, 0, sizeof(digitalValues));
+		memset(analogValues, 0, sizeof(analogValues));
+		memset(analogInputs, 0, sizeof(analogInputs));
+
+		SREG = _BV(SREG_I);
+		WDTCSR = 0;
+		MCUSR = 0;
+		watchdogDeadline = 0;
+		resets = 0;
+	}
+
+	void setTime(unsigned long us) {
+		now = us;
+	}
+
+	void setPinWriteHook(PinWriteHook hook, void *context) {
+		pinWriteHook = hook;
+		pinWriteContext = context;
+	}
+
+	int digitalValue(uint8_t pin) {
+		return pin < PIN_COUNT ? digitalValues[pin] : 0;
+	}
+
+	int analogValue(uint8_t pin) {
+		return pin < PIN_COUNT ? analogValues[pin] : 0;
+	}
+
+	void setAnalogInput(uint8_t pin, int value) {
+		if (pin < PIN_COUNT) {
+			analogInputs[pin] = value;
+		}
+	}
+
+	void eraseEeprom(void) {
+		memset(eeprom, 0xFF, sizeof(eeprom));
+	}
+
+	unsigned long watchdogResets(void) {
+		return resets;
+	}
+
+	static unsigned long watchdogPeriod(void) {
+		uint8_t prescaler = (WDTCSR & 0x07) | ((WDTCSR & _BV(WDP3)) ? 0x08 : 0);
+		return WATCHDOG_BASE_PERIOD_US << prescaler;
+	}
+
+	static bool watchdogRunning(void) {
+		return WDTCSR & (_BV(WDE) | _BV(WDIE));
+	}
+
+	static void watchdogTimeout(void) {
+		if (WDTCSR & _BV(WDIE)) {
+			// In interrupt + system reset mode the hardware clears WDIE on time-out, the next time-out resets
+			if (WDTCSR & _BV(WDE)) {
+				WDTCSR &= ~_BV(WDIE);
+			}
+			WDTCSR |= _BV(WDIF);
+		}
+		else {
+			// There is no way to restart the program on the host, count it and stop the watchdog
+			resets++;
+			MCUSR |= _BV(WDRF);
+			WDTCSR = 0;
+		}
+	}
+
+	static void deliverInterrupts(void) {
+		if ((WDTCSR & _BV(WDIF)) && (SREG & _BV(SREG_I))) {
+			WDTCSR &= ~_BV(WDIF);
+			if (WDT_vect != nullptr) {
+				uint8_t oldSREG = SREG;
+				cli();
+				WDT_vect();
+				SREG = oldSREG;
+			}
+		}
+	}
+
+	/**
+	 * @brief Moves time forward, delivering the watchdog interrupts that fall in between
+	 */
+	static void advance(unsigned long us) {
+		unsigned long end = now + us;
+
+		deliverInterrupts();
+
+		while (watchdogRunning() && (long) (end - watchdogDeadline) >= 0) {
+			if ((long) (watchdogDeadline - now) > 0) {
+				now = watchdogDeadline;
+			}
+			watchdogDeadline += watchdogPeriod();
+			watchdogTimeout();
+			deliverInterrupts();
+		}
+
+		// Time spent in interrupts is taken from the delay, as delay() polls micros() on the target
+		if ((long) (end - now) > 0) {
+			now = end;
+		}
+	}
+
+} // namespace ArduinoHost
+
+struct EepromInitializer {
+	EepromInitializer(void) {
+		ArduinoHost::eraseEeprom();
+	}
+};
+
+static EepromInitializer eepromInitializer;
+
+
+//
+// Mark:- Time
+//
+
+unsigned long millis(void) {
+	return ArduinoHost::now / 1000;
+}
+
+unsigned long micros(void) {
+	return ArduinoHost::now;
+}
+
+void delay(unsigned long ms) {
+	ArduinoHost::advance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	ArduinoHost::advance(us);
+}
+
+
+//
+// Mark:- Watchdog
+//
+
+void wdt_enable(uint8_t timeout) {
+	WDTCSR = _BV(WDE) | (timeout & 0x07) | ((timeout & 0x08) ? _BV(WDP3) : 0);
+	wdt_reset();
+}
+
+void wdt_disable(void) {
+	WDTCSR = 0;
+}
+
+void wdt_reset(void) {
+	ArduinoHost::watchdogDeadline = ArduinoHost::now + ArduinoHost::watchdogPeriod();
+}
+
+
+//
+// Mark:- EEPROM
+//
+
+uint8_t eeprom_read_byte(const uint8_t *address) {
+	return ArduinoHost::eeprom[(uintptr_t) address % (E2END + 1)];
+}
+
+void eeprom_update_byte(uint8_t *address, uint8_t value) {
+	ArduinoHost::eeprom[(uintptr_t) address % (E2END + 1)] = value;
+}
+
+
+//
+// Mark:- Pins
+//
+
+void pinMode(uint8_t, uint8_t) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	ArduinoHost::now += ArduinoHost::DIGITAL_WRITE_US;
+	if (pin < PIN_COUNT) {
+		ArduinoHost::digitalValues[pin] = value;
+	}
+	if (ArduinoHost::pinWriteHook != nullptr) {
+		ArduinoHost::pinWriteHook(ArduinoHost::PinWrite::digital, pin, value, ArduinoHost::pinWriteContext);
+	}
+}
+
+void analogWrite(uint8_t pin, int value) {
+	ArduinoHost::now += ArduinoHost::ANALOG_WRITE_US;
+	if (pin < PIN_COUNT) {
+		ArduinoHost::analogValues[pin] = value;
+	}
+	if (ArduinoHost::pinWriteHook != nullptr) {
+		ArduinoHost::pinWriteHook(ArduinoHost::PinWrite::analog, pin, value, ArduinoHost::pinWriteContext);
+	}
+}
+
+int analogRead(uint8_t pin) {
+	ArduinoHost::now += ArduinoHost::ANALOG_READ_US;
+	return pin < PIN_COUNT ? ArduinoHost::analogInputs[pin] : 0;
+}
+
+
+//
+// Mark:- Print
+//
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+	size_t written = 0;
+	while (size--) {
+		written += write(*buffer++);
+	}
+	return written;
+}
+
+size_t Print::print(const char *string) {
+	return write((const uint8_t *) string, strlen(string));
+}
+
+size_t Print::print(char c) {
+	return write((uint8_t) c);
+}
+
+size_t Print::print(int value) {
+	return print((long) value);
+}
+
+size_t Print::print(unsigned int value) {
+	return print((unsigned long) value);
+}
+
+size_t Print::print(long value) {
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "%ld", value);
+	return print(buffer);
+}
+
+size_t Print::print(unsigned long value) {
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), "%lu", value);
+	return print(buffer);
+}
+
+size_t Print::println(void) {
+	return print("\r\n");
+}
+
+size_t Print::println(const char *string) {
+	return print(string) + println();
+}
+
+
+//
+// Mark:- HardwareSerial
+//
+
+HardwareSerial::HardwareSerial(FILE *stream) {
+	_stream = stream;
+	_capture = false;
+}
+
+void HardwareSerial::begin(unsigned long) {
+}
+
+size_t HardwareSerial::write(uint8_t byte) {
+	if (_capture) {
+		_output.push_back((char) byte);
+		return 1;
+	}
+	if (_stream == nullptr) {
+		return 1;
+	}
+	return fputc(byte, _stream) == EOF ? 0 : 1;
+}
+
+void HardwareSerial::capture(bool enabled) {
+	_capture = enabled;
+}
+
+const std::string & HardwareSerial::output(void) const {
+	return _output;
+}
+
+void HardwareSerial::clearOutput(void) {
+	_output.clear();
+}
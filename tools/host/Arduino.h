@@ -0,0 +1,144 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_HOST_ARDUINO_H_
+#define LEKA_HOST_ARDUINO_H_
+
+/**
+ * @file Arduino.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Host (Linux/macOS) stand-in for the Arduino core, just enough to compile
+ * the libraries in lib/ with g++ or clang++.
+ *
+ * Time is virtual: it only moves with delay(), delayMicroseconds() or
+ * ArduinoHost::setTime(), so a run is deterministic and as fast as the host.
+ * Pin writes are reported to an optional hook instead of touching hardware.
+ *
+ * To keep measured latencies meaningful, pin functions add their approximate
+ * ATmega2560 @ 16MHz cost to the virtual time. Interrupts (the watchdog) are
+ * only delivered while time moves in delay() or delayMicroseconds().
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/wdt.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH   0x1
+#define LOW    0x0
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+
+#define A0     54
+#define A1     55
+
+#define _BV(bit) (1 << (bit))
+
+#define F(string) (string)
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+void analogWrite(uint8_t pin, int value);
+int analogRead(uint8_t pin);
+
+namespace ArduinoHost {
+
+	enum class PinWrite : uint8_t {
+		digital = 0,
+		analog  = 1
+	};
+
+	typedef void (*PinWriteHook)(PinWrite kind, uint8_t pin, int value, void *context);
+
+	const unsigned long DIGITAL_WRITE_US = 4;
+	const unsigned long ANALOG_WRITE_US  = 6;
+	const unsigned long ANALOG_READ_US   = 112;
+
+	void reset(void);
+	void setTime(unsigned long us);
+	void setPinWriteHook(PinWriteHook hook, void *context = nullptr);
+
+	int digitalValue(uint8_t pin);
+	int analogValue(uint8_t pin);
+	void setAnalogInput(uint8_t pin, int value);
+
+	void eraseEeprom(void);
+	unsigned long watchdogResets(void);
+
+} // namespace ArduinoHost
+
+class Print {
+	public:
+		virtual ~Print(void) {}
+
+		virtual size_t write(uint8_t byte) = 0;
+
+		size_t write(const uint8_t *buffer, size_t size);
+
+		size_t print(const char *string);
+		size_t print(char c);
+		size_t print(int value);
+		size_t print(unsigned int value);
+		size_t print(long value);
+		size_t print(unsigned long value);
+
+		size_t println(void);
+		size_t println(const char *string);
+};
+
+class HardwareSerial : public Print {
+	public:
+		HardwareSerial(FILE *stream);
+
+		void begin(unsigned long baudrate);
+		size_t write(uint8_t byte);
+
+		using Print::write;
+
+		// Host only, keeps the output in memory instead of writing it to the stream
+		void capture(bool enabled);
+		const std::string & output(void) const;
+		void clearOutput(void);
+
+	private:
+		FILE *_stream;
+		bool _capture;
+		std::string _output;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
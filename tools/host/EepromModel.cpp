@@ -0,0 +1,109 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#include "EepromModel.h"
+
+
+/**
+ * @file EepromModel.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+/**
+ * @brief Instantiates a new erased EEPROM
+ * @param length the size in bytes
+ */
+EepromModel::EepromModel(uint16_t length) : _cells(length, 0xFF), _wear(length, 0) {
+	_writes = 0;
+	_budget = -1;
+}
+
+uint8_t EepromModel::read(uint16_t address) {
+	return _cells.at(address);
+}
+
+void EepromModel::write(uint16_t address, uint8_t value) {
+	if (_cells.at(address) == value) {
+		return;
+	}
+
+	if (_budget == 0) {
+		_budget = -1;
+		_cells[address] = 0xFF;
+		_wear[address]++;
+		throw PowerLoss();
+	}
+
+	if (_budget > 0) {
+		_budget--;
+	}
+
+	_cells[address] = value;
+	_wear[address]++;
+	_writes++;
+}
+
+uint16_t EepromModel::length(void) {
+	return _cells.size();
+}
+
+/**
+ * @brief Sets every cell without counting wear, i.e. to simulate a blank chip
+ */
+void EepromModel::fill(uint8_t value) {
+	for (auto &cell : _cells) {
+		cell = value;
+	}
+}
+
+/**
+ * @brief Schedules a power loss
+ * @param writes the number of physical writes that still succeed, -1 to disable
+ */
+void EepromModel::powerLossAfter(long writes) {
+	_budget = writes;
+}
+
+/**
+ * @brief Returns the number of successful physical writes
+ */
+unsigned long EepromModel::writes(void) const {
+	return _writes;
+}
+
+/**
+ * @brief Returns the number of physical writes to a cell
+ */
+unsigned long EepromModel::wear(uint16_t address) const {
+	return _wear.at(address);
+}
+
+/**
+ * @brief Returns the number of physical writes to the most written cell
+ */
+unsigned long EepromModel::maxWear(void) const {
+	unsigned long max = 0;
+	for (auto wear : _wear) {
+		if (wear > max) {
+			max = wear;
+		}
+	}
+	return max;
+}
@@ -0,0 +1,67 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_HOST_EEPROM_MODEL_H_
+#define LEKA_HOST_EEPROM_MODEL_H_
+
+/**
+ * @file EepromModel.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ */
+
+#include <vector>
+
+#include <Arduino.h>
+#include "IEeprom.h"
+
+/**
+ * @class EepromModel
+ * @brief Host EEPROM with per cell wear counters and power loss injection
+ *
+ * Writes behave like eeprom_update_byte(): writing the value a cell already
+ * holds costs nothing. After powerLossAfter(n), the n first physical writes
+ * succeed, the next one tears the cell (left erased, 0xFF) and throws PowerLoss.
+ */
+
+class EepromModel : public IEeprom {
+	public:
+		struct PowerLoss {};
+
+		EepromModel(uint16_t length);
+
+		uint8_t read(uint16_t address);
+		void write(uint16_t address, uint8_t value);
+		uint16_t length(void);
+
+		void fill(uint8_t value);
+		void powerLossAfter(long writes);
+
+		unsigned long writes(void) const;
+		unsigned long wear(uint16_t address) const;
+		unsigned long maxWear(void) const;
+
+	private:
+		std::vector<uint8_t> _cells;
+		std::vector<unsigned long> _wear;
+		unsigned long _writes;
+		long _budget;
+};
+
+#endif
@@ -0,0 +1,38 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_HOST_AVR_EEPROM_H_
+#define LEKA_HOST_AVR_EEPROM_H_
+
+/**
+ * @file eeprom.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Host stand-in for avr-libc <avr/eeprom.h>, backed by a RAM array of E2END + 1 bytes.
+ */
+
+#include <stdint.h>
+
+#define E2END 0xFFF
+
+uint8_t eeprom_read_byte(const uint8_t *address);
+void eeprom_update_byte(uint8_t *address, uint8_t value);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_HOST_AVR_INTERRUPT_H_
+#define LEKA_HOST_AVR_INTERRUPT_H_
+
+/**
+ * @file interrupt.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Host stand-in for avr-libc <avr/interrupt.h>. Bit 7 of SREG is the global
+ * interrupt flag, interrupts are only delivered from delay() and
+ * delayMicroseconds(), see Arduino.h.
+ */
+
+#include <stdint.h>
+
+#define SREG_I 7
+
+#define WDT_vect host_WDT_vect
+
+#define ISR(vector) extern "C" void vector(void)
+
+extern uint8_t SREG;
+
+inline void cli(void) {
+	SREG &= ~(1 << SREG_I);
+}
+
+inline void sei(void) {
+	SREG |= (1 << SREG_I);
+}
+
+#endif
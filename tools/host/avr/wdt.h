@@ -0,0 +1,62 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+#ifndef LEKA_HOST_AVR_WDT_H_
+#define LEKA_HOST_AVR_WDT_H_
+
+/**
+ * @file wdt.h
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Host stand-in for avr-libc <avr/wdt.h>, the watchdog is simulated by
+ * Arduino.cpp: on timeout it calls ISR(WDT_vect) if WDIE is set, or counts
+ * a reset otherwise (see ArduinoHost::watchdogResets()).
+ */
+
+#include <stdint.h>
+
+#define WDP0  0
+#define WDP1  1
+#define WDP2  2
+#define WDE   3
+#define WDCE  4
+#define WDP3  5
+#define WDIE  6
+#define WDIF  7
+
+#define WDRF  3
+
+#define WDTO_15MS  0
+#define WDTO_30MS  1
+#define WDTO_60MS  2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S    6
+#define WDTO_2S    7
+
+extern uint8_t WDTCSR;
+extern uint8_t MCUSR;
+
+void wdt_enable(uint8_t timeout);
+void wdt_disable(void);
+void wdt_reset(void);
+
+#endif
@@ -0,0 +1,158 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+/**
+ * @file powerloss.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Checks that CycleLog always recovers either the previous or the new commit
+ * when power is lost before, during or after any byte of a commit, across
+ * several turns of the ring and across the 16 bits sequence wrap around.
+ *
+ * Usage: powerloss [commits]
+ */
+
+#include <stdlib.h>
+
+#include <Arduino.h>
+#include "CycleLog.h"
+#include "EepromModel.h"
+
+static const uint16_t EEPROM_LENGTH = 128;
+static const uint16_t LOG_START     = 16;
+static const uint16_t LOG_LENGTH    = 64;
+
+static unsigned long failures = 0;
+
+#define check(condition, ...) do {        \
+	if (!(condition)) {                   \
+		failures++;                       \
+		printf("FAIL: " __VA_ARGS__);     \
+		printf(" (%s)\n", #condition);    \
+	}                                     \
+} while(0)
+
+static uint8_t resultOf(uint32_t cycle) {
+	return (cycle * 37) & 0xFF;
+}
+
+static void checkBlank(uint8_t value) {
+	EepromModel eeprom = EepromModel(EEPROM_LENGTH);
+	eeprom.fill(value);
+
+	CycleLog log = CycleLog(eeprom, LOG_START, LOG_LENGTH);
+	check(!log.restore(), "EEPROM filled with 0x%02X restored a commit", value);
+	check(log.isEmpty() && log.cycle() == 0, "EEPROM filled with 0x%02X is not empty", value);
+
+	log.commit(1, resultOf(1));
+
+	CycleLog restored = CycleLog(eeprom, LOG_START, LOG_LENGTH);
+	check(restored.restore() && restored.cycle() == 1, "first commit on EEPROM filled with 0x%02X lost", value);
+}
+
+static void checkPowerLoss(uint32_t commits) {
+	EepromModel eeprom = EepromModel(EEPROM_LENGTH);
+	CycleLog log = CycleLog(eeprom, LOG_START, LOG_LENGTH);
+	log.restore();
+
+	unsigned long tears = 0;
+
+	for (uint32_t cycle = 1; cycle <= commits; ++cycle) {
+		uint32_t previous = cycle - 1;
+
+		for (long budget = 0; ; ++budget) {
+			EepromModel torn = eeprom;
+			CycleLog tornLog = CycleLog(torn, LOG_START, LOG_LENGTH);
+			tornLog.restore();
+
+			torn.powerLossAfter(budget);
+
+			bool lost = false;
+			try {
+				tornLog.commit(cycle, resultOf(cycle));
+			}
+			catch (EepromModel::PowerLoss &) {
+				lost = true;
+				tears++;
+			}
+
+			CycleLog recovered = CycleLog(torn, LOG_START, LOG_LENGTH);
+			bool found = recovered.restore();
+
+			if (!lost) {
+				check(found && recovered.cycle() == cycle && recovered.result() == resultOf(cycle),
+						"cycle %u: completed commit not recovered", cycle);
+				break;
+			}
+
+			if (previous == 0) {
+				check(!found || recovered.cycle() == cycle,
+						"cycle %u, power loss after %ld writes: recovered cycle %u", cycle, budget, recovered.cycle());
+			}
+			else {
+				check(found && (recovered.cycle() == previous || recovered.cycle() == cycle),
+						"cycle %u, power loss after %ld writes: recovered cycle %u", cycle, budget, recovered.cycle());
+			}
+			check(recovered.result() == resultOf(recovered.cycle()) || !found,
+					"cycle %u, power loss after %ld writes: result does not match its cycle", cycle, budget);
+
+			// The rig restarts and commits again on top of the torn slot
+			torn.powerLossAfter(-1);
+			recovered.commit(cycle, resultOf(cycle));
+
+			CycleLog restarted = CycleLog(torn, LOG_START, LOG_LENGTH);
+			check(restarted.restore() && restarted.cycle() == cycle,
+					"cycle %u, power loss after %ld writes: commit after restart lost", cycle, budget);
+		}
+
+		log.commit(cycle, resultOf(cycle));
+	}
+
+	for (uint16_t address = 0; address < EEPROM_LENGTH; ++address) {
+		if (address < LOG_START || address >= LOG_START + LOG_LENGTH) {
+			check(eeprom.wear(address) == 0, "address %u outside of the log was written", address);
+		}
+	}
+
+	unsigned long expectedWear = (commits + log.capacity() - 1) / log.capacity();
+	check(eeprom.maxWear() <= expectedWear, "max wear %lu, expected at most %lu", eeprom.maxWear(), expectedWear);
+
+	for (uint16_t age = 0; age < log.capacity() && age < commits; ++age) {
+		CycleRecord record;
+		check(log.read(age, record) && record.cycle == commits - age,
+				"history of age %u does not hold cycle %u", age, commits - age);
+	}
+
+	printf("%u commits, %lu power losses, %lu writes, max wear %lu per cell for %u slots\n",
+			commits, tears, eeprom.writes(), eeprom.maxWear(), log.capacity());
+}
+
+int main(int argc, char **argv) {
+	// Enough commits to wrap the 16 bits sequence number
+	uint32_t commits = argc > 1 ? strtoul(argv[1], nullptr, 10) : 70000;
+
+	checkBlank(0xFF);
+	checkBlank(0x00);
+	checkPowerLoss(commits);
+
+	printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+
+	return failures == 0 ? 0 : 1;
+}
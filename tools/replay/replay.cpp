@@ -0,0 +1,224 @@
+/*
+   Copyright (C) 2013-2018 Ladislas de Toldi <ladislas at leka dot io> and Leka <http://leka.io>
+
+   This file is part of Leka, a spherical robotic smart toy for autistic children.
+
+   Leka is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   Leka is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with Leka. If not, see <http://www.gnu.org/licenses/>.
+   */
+
+/**
+ * @file replay.cpp
+ * @author Ladislas de Toldi
+ * @version 1.0
+ *
+ * Replays a MotorTrace capture into host Motor instances at full speed.
+ *
+ * Usage: replay [--dump] [--runs N] trace.bin
+ *
+ * The summary ends with a digest of every pin write (virtual time, pin, value),
+ * two firmware builds fed with the same trace drive the pins identically
+ * if and only if their digests match.
+ */
+
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+#include <Arduino.h>
+#include "IMotor.h"
+#include "Motor.h"
+#include "MotorTrace.h"
+
+// Keep in sync with src/Motors/main.cpp
+struct MotorPins {
+	uint8_t directionPin;
+	uint8_t speedPin;
+};
+
+static const MotorPins MOTOR_PINS[] = {
+	{ 4, 5 }, // MOTOR_LEFT_ID
+	{ 7, 6 }, // MOTOR_RIGHT_ID
+};
+
+static const uint8_t MOTOR_COUNT = sizeof(MOTOR_PINS) / sizeof(MOTOR_PINS[0]);
+
+struct Replay {
+	Motor *motors[MOTOR_COUNT];
+	bool dump;
+
+	unsigned long lastTime;
+	unsigned long unknownMotors;
+	unsigned long pinWrites;
+	uint64_t digest;
+};
+
+static void hashValue(Replay &replay, uint64_t value) {
+	for (uint8_t i = 0; i < 8; ++i) {
+		replay.digest ^= (value >> (i * 8)) & 0xFF;
+		replay.digest *= 0x100000001B3ULL;
+	}
+}
+
+static void onPinWrite(ArduinoHost::PinWrite kind, uint8_t pin, int value, void *context) {
+	Replay &replay = *static_cast<Replay *>(context);
+
+	replay.pinWrites++;
+	hashValue(replay, micros());
+	hashValue(replay, ((uint64_t) kind << 40) | ((uint64_t) pin << 32) | (uint32_t) value);
+}
+
+static void onCommand(const MotorCommand &command, void *context) {
+	Replay &replay = *static_cast<Replay *>(context);
+
+	replay.lastTime = command.time;
+	ArduinoHost::setTime(command.time * 1000);
+
+	if (replay.dump) {
+		printf("%10lu ms  motor %u  %-16s  %3u\n",
+				command.time,
+				command.motor,
+				command.rotation == Rotation::clockwise ? "clockwise" : "counterClockwise",
+				command.speed);
+	}
+
+	if (command.motor >= MOTOR_COUNT) {
+		replay.unknownMotors++;
+		return;
+	}
+
+	replay.motors[command.motor]->spin(command.rotation, command.speed);
+}
+
+static bool readFile(const char *path, std::vector<uint8_t> &content) {
+	FILE *file = fopen(path, "rb");
+
+	if (file == nullptr) {
+		return false;
+	}
+
+	uint8_t buffer[4096];
+	size_t length;
+
+	while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		content.insert(content.end(), buffer, buffer + length);
+	}
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: replay [--dump] [--runs N] trace.bin\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	bool dump = false;
+	long runs = 1;
+	const char *path = nullptr;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--dump") == 0) {
+			dump = true;
+		}
+		else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+			runs = strtol(argv[++i], nullptr, 10);
+		}
+		else if (argv[i][0] != '-' && path == nullptr) {
+			path = argv[i];
+		}
+		else {
+			usage();
+		}
+	}
+
+	if (path == nullptr || runs < 1) {
+		usage();
+	}
+
+	std::vector<uint8_t> trace;
+
+	if (!readFile(path, trace)) {
+		fprintf(stderr, "replay: cannot read %s\n", path);
+		return 1;
+	}
+
+	Replay replay;
+	double bestNs = 0;
+	unsigned long commands = 0;
+	unsigned long dropped = 0;
+	unsigned long errors = 0;
+
+	for (long run = 0; run < runs; ++run) {
+		ArduinoHost::reset();
+
+		Motor left  = Motor(MOTOR_PINS[0].directionPin, MOTOR_PINS[0].speedPin);
+		Motor right = Motor(MOTOR_PINS[1].directionPin, MOTOR_PINS[1].speedPin);
+
+		replay.motors[0] = &left;
+		replay.motors[1] = &right;
+		replay.dump = dump && run == 0;
+		replay.lastTime = 0;
+		replay.unknownMotors = 0;
+		replay.pinWrites = 0;
+		replay.digest = 0xCBF29CE484222325ULL;
+
+		ArduinoHost::setPinWriteHook(onPinWrite, &replay);
+		MotorTraceDecoder decoder = MotorTraceDecoder(onCommand, &replay);
+
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint8_t byte : trace) {
+			decoder.decode(byte);
+		}
+		decoder.finish();
+
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+		if (run == 0 || ns < bestNs) {
+			bestNs = ns;
+		}
+
+		commands = decoder.commands();
+		dropped = decoder.dropped();
+		errors = decoder.errors();
+	}
+
+	ArduinoHost::setPinWriteHook(nullptr);
+
+	printf("trace          : %s (%zu bytes)\n", path, trace.size());
+	printf("commands       : %lu\n", commands);
+	printf("dropped        : %lu\n", dropped);
+	printf("invalid frames : %lu\n", errors);
+	printf("unknown motors : %lu\n", replay.unknownMotors);
+	printf("duration       : %lu ms\n", replay.lastTime);
+	printf("pin writes     : %lu\n", replay.pinWrites);
+
+	for (uint8_t i = 0; i < MOTOR_COUNT; ++i) {
+		printf("motor %u        : direction %d speed %d\n",
+				i,
+				ArduinoHost::digitalValue(MOTOR_PINS[i].directionPin),
+				ArduinoHost::analogValue(MOTOR_PINS[i].speedPin));
+	}
+
+	printf("replay         : best of %ld run(s) %.0f ns, %.1f ns/command\n",
+			runs,
+			bestNs,
+			commands != 0 ? bestNs / commands : 0.0);
+	printf("digest         : %016llx\n", (unsigned long long) replay.digest);
+
+	return errors != 0 ? 1 : 0;
+}